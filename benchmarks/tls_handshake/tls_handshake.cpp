@@ -0,0 +1,113 @@
+//
+// Measures full and resumed TLS handshake rates against a local ssl_server.
+//
+// build: g++ -std=c++14 -O2 -I../.. tls_handshake.cpp
+//            -lboost_filesystem -lboost_coroutine -lboost_context -lssl -lcrypto -lpthread
+// usage: tls_handshake [count] [tickets|cache] [port]
+//
+
+#define BOOST_ASIO_HTTP_USE_SSL
+#include "boost_asio_http_server.hpp"
+
+#include "../../tests/SelfSignedCert.h"
+
+#include <iostream>
+#include <thread>
+
+using namespace boost_asio_http;
+
+void ping(request&, response& rs)
+{
+    rs.set_code(response::ok);
+    rs.set_content_type("text/plain");
+    rs.set_content_length(4);
+    rs.stream() << "pong";
+}
+
+// One connection: handshake, GET /Ping, read the response until close_notify.
+// Returns true when the server resumed 'session'; 'session' is replaced by the newest one.
+static bool connect_once(boost::asio::io_context& ioContext, boost::asio::ssl::context& clientContext, const boost::asio::ip::tcp::endpoint& endpoint, SSL_SESSION*& session)
+{
+    boost::asio::ssl::stream<boost::asio::ip::tcp::socket> stream(ioContext, clientContext);
+    stream.lowest_layer().connect(endpoint);
+    if (session) SSL_set_session(stream.native_handle(), session);
+    stream.handshake(boost::asio::ssl::stream_base::client);
+
+    const std::string rq = "GET /Ping HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    boost::asio::write(stream, boost::asio::buffer(rq));
+
+    boost::system::error_code ec;
+    std::array<char, 1024> buffer;
+    while (!ec) stream.read_some(boost::asio::buffer(buffer), ec);
+
+    bool reused = SSL_session_reused(stream.native_handle()) == 1;
+    if (session) SSL_SESSION_free(session);
+    session = SSL_get1_session(stream.native_handle());
+
+    stream.shutdown(ec);
+    return reused;
+}
+
+static void run(const char* label, int count, bool resume, boost::asio::io_context& ioContext, boost::asio::ssl::context& clientContext, const boost::asio::ip::tcp::endpoint& endpoint)
+{
+    SSL_SESSION* session = nullptr;
+    if (resume) connect_once(ioContext, clientContext, endpoint, session);
+
+    int reused = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        if (!resume && session) {
+            SSL_SESSION_free(session);
+            session = nullptr;
+        }
+        if (connect_once(ioContext, clientContext, endpoint, session)) reused++;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (session) SSL_SESSION_free(session);
+
+    std::cout << label << ": " << count << " connections in " << elapsed.count() << " s, "
+              << count / elapsed.count() << " handshakes/s, " << reused << " resumed" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? std::atoi(argv[1]) : 1000;
+    bool tickets = !(argc > 2 && std::string(argv[2]) == "cache");
+    std::string port = argc > 3 ? argv[3] : "8443";
+
+    std::string certPem, keyPem;
+    makeSelfSigned(certPem, keyPem);
+
+    ssl_context context;
+    context.native().use_certificate_chain(boost::asio::buffer(certPem));
+    context.native().use_private_key(boost::asio::buffer(keyPem), boost::asio::ssl::context::pem);
+    context.set_session_cache(1024, std::chrono::seconds(300));
+    if (tickets) {
+        context.enable_session_tickets(std::chrono::seconds(3600));
+    } else {
+        context.disable_session_tickets();
+    }
+
+    ssl_server s("127.0.0.1", port, "./doc", context);
+    if (!s.is_valid()) {
+        std::cerr << "cannot listen on 127.0.0.1:" << port << std::endl;
+        return 1;
+    }
+    s.set_get_handler("/Ping", ping);
+    std::thread thread(&ssl_server::run, &s);
+
+    boost::asio::io_context ioContext;
+    boost::asio::ssl::context clientContext(boost::asio::ssl::context::tls_client);
+    clientContext.set_verify_mode(boost::asio::ssl::verify_none);
+    SSL_CTX_set_session_cache_mode(clientContext.native_handle(), SSL_SESS_CACHE_CLIENT);
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(std::stoi(port)));
+
+    std::cout << "session resumption by " << (tickets ? "tickets" : "server cache") << std::endl;
+    run("full   ", count, false, ioContext, clientContext, endpoint);
+    run("resumed", count, true, ioContext, clientContext, endpoint);
+
+    s.stop();
+    thread.join();
+
+    return 0;
+}
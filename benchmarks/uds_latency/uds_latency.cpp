@@ -0,0 +1,136 @@
+//
+// Compares request latency over 127.0.0.1 and a Unix domain socket on the same server.
+//
+// build: g++ -std=c++14 -O2 -I../.. uds_latency.cpp
+//            -lboost_filesystem -lboost_coroutine -lboost_context -lpthread
+// usage: uds_latency [count] [port] [socket path]
+//
+
+#include "boost_asio_http_server.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+using namespace boost_asio_http;
+
+void ping(request&, response& rs)
+{
+    rs.set_code(response::ok);
+    rs.set_content_type("text/plain");
+    rs.set_content_length(4);
+    rs.stream() << "pong";
+}
+
+void echo(request&, websocket& ws)
+{
+    std::string message;
+    websocket::message_type type;
+    while (ws.receive(message, type)) ws.send(message, type);
+}
+
+// One GET /Ping on a new connection, read until the server closes it.
+template <class Protocol>
+static void get_once(boost::asio::io_context& ioContext, const typename Protocol::endpoint& endpoint)
+{
+    typename Protocol::socket socket(ioContext);
+    socket.connect(endpoint);
+
+    const std::string rq = "GET /Ping HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    boost::asio::write(socket, boost::asio::buffer(rq));
+
+    boost::system::error_code ec;
+    std::array<char, 1024> buffer;
+    while (!ec) socket.read_some(boost::asio::buffer(buffer), ec);
+}
+
+// Opens a WebSocket to /Echo; the caller exchanges frames on it.
+template <class Protocol>
+static void open_websocket(typename Protocol::socket& socket, const typename Protocol::endpoint& endpoint)
+{
+    socket.connect(endpoint);
+
+    const std::string rq = "GET /Echo HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                           "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    boost::asio::write(socket, boost::asio::buffer(rq));
+
+    boost::asio::streambuf header;
+    boost::asio::read_until(socket, header, "\r\n\r\n");
+}
+
+// Sends a 64-byte masked binary message and waits for its echo.
+template <class Socket>
+static void echo_once(Socket& socket)
+{
+    std::array<unsigned char, 2 + 4 + 64> frame = { 0x82, 0x80 | 64, 1, 2, 3, 4 };
+    boost::asio::write(socket, boost::asio::buffer(frame));
+
+    std::array<unsigned char, 2 + 64> reply;
+    boost::asio::read(socket, boost::asio::buffer(reply));
+}
+
+static void report(const char* label, std::vector<double>& samples)
+{
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (auto s : samples) sum += s;
+
+    std::cout << std::left << std::setw(28) << label << std::right << std::fixed << std::setprecision(1)
+              << " mean " << std::setw(7) << sum / samples.size() << " us"
+              << "  p50 " << std::setw(7) << samples[samples.size() / 2] << " us"
+              << "  p99 " << std::setw(7) << samples[samples.size() * 99 / 100] << " us" << std::endl;
+}
+
+template <class F>
+static void measure(const char* label, int count, F f)
+{
+    for (int i = 0; i < count / 10; i++) f();   // warm up
+
+    std::vector<double> samples;
+    for (int i = 0; i < count; i++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        samples.push_back(elapsed.count());
+    }
+    report(label, samples);
+}
+
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? std::atoi(argv[1]) : 10000;
+    std::string port = argc > 2 ? argv[2] : "8080";
+    std::string path = argc > 3 ? argv[3] : "/tmp/uds_latency.sock";
+
+    server s("127.0.0.1", port, "./doc");
+    if (!s.is_valid() || !s.listen_local(path)) {
+        std::cerr << "cannot listen on 127.0.0.1:" << port << " or " << path << std::endl;
+        return 1;
+    }
+    s.set_get_handler("/Ping", ping);
+    s.set_websocket_handler("/Echo", echo);
+    std::thread thread(&server::run, &s);
+
+    boost::asio::io_context ioContext;
+    boost::asio::ip::tcp::endpoint tcpEndpoint(boost::asio::ip::make_address("127.0.0.1"), static_cast<unsigned short>(std::stoi(port)));
+    boost::asio::local::stream_protocol::endpoint localEndpoint(path);
+
+    measure("GET, tcp 127.0.0.1", count, [&]() { get_once<boost::asio::ip::tcp>(ioContext, tcpEndpoint); });
+    measure("GET, unix socket", count, [&]() { get_once<boost::asio::local::stream_protocol>(ioContext, localEndpoint); });
+
+    boost::asio::ip::tcp::socket tcpSocket(ioContext);
+    open_websocket<boost::asio::ip::tcp>(tcpSocket, tcpEndpoint);
+    tcpSocket.set_option(boost::asio::ip::tcp::no_delay(true));
+    measure("WebSocket echo, tcp", count, [&]() { echo_once(tcpSocket); });
+
+    boost::asio::local::stream_protocol::socket localSocket(ioContext);
+    open_websocket<boost::asio::local::stream_protocol>(localSocket, localEndpoint);
+    measure("WebSocket echo, unix socket", count, [&]() { echo_once(localSocket); });
+
+    tcpSocket.close();
+    localSocket.close();
+    s.stop();
+    thread.join();
+
+    return 0;
+}
@@ -14,17 +14,49 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/spawn.hpp>
 
+#include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/find.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
 #include <boost/filesystem.hpp>
-
+#include <boost/utility/string_view.hpp>
+
+#ifdef BOOST_ASIO_HTTP_USE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef BOOST_ASIO_HTTP_USE_SSL
+#include <boost/asio/ssl.hpp>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#else
+#include <openssl/hmac.h>
+#endif
+#endif
+
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <deque>
 #include <functional>
 #include <ios>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 namespace boost_asio_http {
 
@@ -32,391 +64,3438 @@ class request;
 class response;
 using handler = std::function<void(request&, response&)>;
 
+class websocket;
+using websocket_handler = std::function<void(request&, websocket&)>;
+
 namespace detail {
 
 constexpr std::streamsize uninitialized_content_length = std::numeric_limits<long long>::max();
+constexpr std::streamsize default_max_form_size = 1024 * 1024;
+constexpr std::size_t max_header_size = 8 * 1024;     // request line and header fields of HTTP/1.1
+constexpr std::size_t max_content_length_digits = 18;   // fits in std::streamsize
+constexpr std::size_t default_max_cache_entries = 1024;
 
-class socket_streambuf : public std::streambuf
+template <std::size_t N>
+constexpr boost::string_view literal(const char (&s)[N])
 {
-public:
-    socket_streambuf(boost::asio::ip::tcp::socket& socket, boost::asio::yield_context yield)
-        : socket_(std::move(socket)), yield_(yield), remained_(detail::uninitialized_content_length)
+    return boost::string_view(s, N - 1);
+}
+
+// "HTTP/1.1 <code> <reason>\r\n" for the codes in the IANA registry; empty for any other code.
+constexpr boost::string_view status_line(int code)
+{
+    switch (code) {
+    case 100: return literal("HTTP/1.1 100 Continue\r\n");
+    case 101: return literal("HTTP/1.1 101 Switching Protocols\r\n");
+    case 102: return literal("HTTP/1.1 102 Processing\r\n");
+    case 103: return literal("HTTP/1.1 103 Early Hints\r\n");
+    case 200: return literal("HTTP/1.1 200 OK\r\n");
+    case 201: return literal("HTTP/1.1 201 Created\r\n");
+    case 202: return literal("HTTP/1.1 202 Accepted\r\n");
+    case 203: return literal("HTTP/1.1 203 Non-Authoritative Information\r\n");
+    case 204: return literal("HTTP/1.1 204 No Content\r\n");
+    case 205: return literal("HTTP/1.1 205 Reset Content\r\n");
+    case 206: return literal("HTTP/1.1 206 Partial Content\r\n");
+    case 207: return literal("HTTP/1.1 207 Multi-Status\r\n");
+    case 208: return literal("HTTP/1.1 208 Already Reported\r\n");
+    case 226: return literal("HTTP/1.1 226 IM Used\r\n");
+    case 300: return literal("HTTP/1.1 300 Multiple Choices\r\n");
+    case 301: return literal("HTTP/1.1 301 Moved Permanently\r\n");
+    case 302: return literal("HTTP/1.1 302 Found\r\n");
+    case 303: return literal("HTTP/1.1 303 See Other\r\n");
+    case 304: return literal("HTTP/1.1 304 Not Modified\r\n");
+    case 305: return literal("HTTP/1.1 305 Use Proxy\r\n");
+    case 307: return literal("HTTP/1.1 307 Temporary Redirect\r\n");
+    case 308: return literal("HTTP/1.1 308 Permanent Redirect\r\n");
+    case 400: return literal("HTTP/1.1 400 Bad Request\r\n");
+    case 401: return literal("HTTP/1.1 401 Unauthorized\r\n");
+    case 402: return literal("HTTP/1.1 402 Payment Required\r\n");
+    case 403: return literal("HTTP/1.1 403 Forbidden\r\n");
+    case 404: return literal("HTTP/1.1 404 Not Found\r\n");
+    case 405: return literal("HTTP/1.1 405 Method Not Allowed\r\n");
+    case 406: return literal("HTTP/1.1 406 Not Acceptable\r\n");
+    case 407: return literal("HTTP/1.1 407 Proxy Authentication Required\r\n");
+    case 408: return literal("HTTP/1.1 408 Request Timeout\r\n");
+    case 409: return literal("HTTP/1.1 409 Conflict\r\n");
+    case 410: return literal("HTTP/1.1 410 Gone\r\n");
+    case 411: return literal("HTTP/1.1 411 Length Required\r\n");
+    case 412: return literal("HTTP/1.1 412 Precondition Failed\r\n");
+    case 413: return literal("HTTP/1.1 413 Content Too Large\r\n");
+    case 414: return literal("HTTP/1.1 414 URI Too Long\r\n");
+    case 415: return literal("HTTP/1.1 415 Unsupported Media Type\r\n");
+    case 416: return literal("HTTP/1.1 416 Range Not Satisfiable\r\n");
+    case 417: return literal("HTTP/1.1 417 Expectation Failed\r\n");
+    case 421: return literal("HTTP/1.1 421 Misdirected Request\r\n");
+    case 422: return literal("HTTP/1.1 422 Unprocessable Content\r\n");
+    case 423: return literal("HTTP/1.1 423 Locked\r\n");
+    case 424: return literal("HTTP/1.1 424 Failed Dependency\r\n");
+    case 425: return literal("HTTP/1.1 425 Too Early\r\n");
+    case 426: return literal("HTTP/1.1 426 Upgrade Required\r\n");
+    case 428: return literal("HTTP/1.1 428 Precondition Required\r\n");
+    case 429: return literal("HTTP/1.1 429 Too Many Requests\r\n");
+    case 431: return literal("HTTP/1.1 431 Request Header Fields Too Large\r\n");
+    case 451: return literal("HTTP/1.1 451 Unavailable For Legal Reasons\r\n");
+    case 500: return literal("HTTP/1.1 500 Internal Server Error\r\n");
+    case 501: return literal("HTTP/1.1 501 Not Implemented\r\n");
+    case 502: return literal("HTTP/1.1 502 Bad Gateway\r\n");
+    case 503: return literal("HTTP/1.1 503 Service Unavailable\r\n");
+    case 504: return literal("HTTP/1.1 504 Gateway Timeout\r\n");
+    case 505: return literal("HTTP/1.1 505 HTTP Version Not Supported\r\n");
+    case 506: return literal("HTTP/1.1 506 Variant Also Negotiates\r\n");
+    case 507: return literal("HTTP/1.1 507 Insufficient Storage\r\n");
+    case 508: return literal("HTTP/1.1 508 Loop Detected\r\n");
+    case 511: return literal("HTTP/1.1 511 Network Authentication Required\r\n");
+    default: return boost::string_view();
+    }
+}
+
+// Reason phrase part of status_line(); empty for unregistered codes.
+constexpr boost::string_view reason_phrase(int code)
+{
+    return status_line(code).empty() ? boost::string_view() : status_line(code).substr(13, status_line(code).size() - 15);
+}
+
+// Writes the IMF-fixdate of 't', e.g. "Sun, 06 Nov 1994 08:49:37 GMT", to 'out' (29 bytes).
+inline void format_http_date(std::time_t t, char* out)
+{
+    static const char days[] = "ThuFriSatSunMonTueWed";   // 1970-01-01 was a Thursday
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+    std::int64_t seconds = static_cast<std::int64_t>(t);
+    std::int64_t z = (seconds >= 0 ? seconds : seconds - 86399) / 86400;
+    int secondOfDay = static_cast<int>(seconds - z * 86400);
+    int dayOfWeek = static_cast<int>(((z % 7) + 7) % 7);
+
+    // civil date from days since the epoch (H. Hinnant, "chrono-Compatible Low-Level Date Algorithms")
+    z += 719468;
+    std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int dayOfEra = static_cast<int>(z - era * 146097);
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int mp = (5 * dayOfYear + 2) / 153;
+    int day = dayOfYear - (153 * mp + 2) / 5 + 1;
+    int month = mp < 10 ? mp + 3 : mp - 9;
+    int year = static_cast<int>(yearOfEra + era * 400) + (month <= 2);
+
+    auto two = [](char* p, int n) { p[0] = static_cast<char>('0' + n / 10); p[1] = static_cast<char>('0' + n % 10); };
+    std::memcpy(out, days + dayOfWeek * 3, 3);
+    std::memcpy(out + 3, ", ", 2);
+    two(out + 5, day);
+    out[7] = ' ';
+    std::memcpy(out + 8, months + (month - 1) * 3, 3);
+    out[11] = ' ';
+    two(out + 12, year / 100 % 100);
+    two(out + 14, year % 100);
+    out[16] = ' ';
+    two(out + 17, secondOfDay / 3600);
+    out[19] = ':';
+    two(out + 20, secondOfDay / 60 % 60);
+    out[22] = ':';
+    two(out + 23, secondOfDay % 60);
+    std::memcpy(out + 25, " GMT", 4);
+}
+
+// "Date: <now>\r\n". Each thread formats it at most once per second.
+inline boost::string_view date_header()
+{
+    struct cache
     {
-        setg(inBuffer_.data(), inBuffer_.data(), inBuffer_.data());
-        setp(outBuffer_.data(), outBuffer_.data() + bufferSize);
+        std::time_t time = -1;
+        std::array<char, 37> line = {{ 'D', 'a', 't', 'e', ':', ' ' }};
+    };
+    static thread_local cache c;
+
+    std::time_t now = std::time(nullptr);
+    if (now != c.time) {
+        format_http_date(now, c.line.data() + 6);
+        c.line[35] = '\r';
+        c.line[36] = '\n';
+        c.time = now;
     }
+    return boost::string_view(c.line.data(), c.line.size());
+}
+
+// A response kept by response_cache. 'header' is what write_header() puts between the Date line and the body.
+struct stored_response
+{
+    int code;
+    std::string contentType;
+    std::string fields;
+    std::string header;
+    std::string body;
+};
 
+class socket_streambuf_base : public std::streambuf
+{
+public:
     void set_remained_size(std::streamsize n)
     {
         remained_ = n - std::distance(gptr(), egptr());
     }
 
+    // Sends "100 Continue" when the handler first reads the body, so none is sent for a request it rejects unread.
+    void expect_continue() { continuePending_ = true; }
+
+    // 'fields' is the block of extra "Name: value\r\n" lines set by the handler.
+    virtual void write_header(int code, boost::string_view contentType, std::streamsize contentLength, boost::string_view fields)
+    {
+        continuePending_ = false;
+        put_status_line(code);
+        put(date_header());
+        put("Content-Type: ");
+        put(contentType);
+        put("\r\n");
+        if (contentLength != detail::uninitialized_content_length) {
+            put("Content-Length: ");
+            put_decimal(contentLength);
+            put("\r\n");
+        }
+        put(fields);
+        put("\r\n");
+    }
+
+    virtual void write_response(const stored_response& r)
+    {
+        continuePending_ = false;
+        put_status_line(r.code);
+        put(date_header());
+        put(r.header);
+
+        // large bodies go out from the stored buffer instead of being copied through the put area
+        if (r.body.size() <= static_cast<std::size_t>(epptr() - pptr())) {
+            put(r.body);
+        } else if (sync() == 0) {
+            boost::system::error_code ec;
+            write(r.body.data(), r.body.size(), ec);
+        }
+    }
+
+    // Coroutine serving this stream, or nullptr when there is none to suspend.
+    virtual boost::asio::yield_context* coroutine() { return nullptr; }
+
 protected:
+    socket_streambuf_base()
+        : remained_(detail::uninitialized_content_length), continuePending_(false)
+    {
+        setg(inBuffer_.data(), inBuffer_.data(), inBuffer_.data());
+        setp(outBuffer_.data(), outBuffer_.data() + bufferSize);
+    }
+
+    virtual std::size_t read_some(char* data, std::size_t size, boost::system::error_code& ec) = 0;
+    virtual void write(const char* data, std::size_t size, boost::system::error_code& ec) = 0;
+
     int underflow()
     {
         if (gptr() || gptr() >= egptr()) {
             if (remained_ <= 0) return traits_type::eof();
+            if (continuePending_) {
+                continuePending_ = false;
+                put("HTTP/1.1 100 Continue\r\n\r\n");
+                if (sync() != 0) return traits_type::eof();
+            }
 
             boost::system::error_code ec;
-            auto n = socket_.async_read_some(boost::asio::buffer(inBuffer_), yield_[ec]);
+            auto n = read_some(inBuffer_.data(), inBuffer_.size(), ec);
             if (ec) return traits_type::eof();
             
             if (remained_ != detail::uninitialized_content_length && remained_ >= 0) {
                 remained_ -= n;
             }
-            setg(inBuffer_.data(), inBuffer_.data(), inBuffer_.data() + n);
+            setg(inBuffer_.data(), inBuffer_.data(), inBuffer_.data() + n);
+        }
+
+        return static_cast<unsigned char>(*gptr());
+    }
+
+    int overflow(int c)
+    {
+        if (sync() != 0) return traits_type::eof();
+
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync()
+    {
+        if (pbase() != pptr()) {
+            boost::system::error_code ec;
+            write(pbase(), std::distance(pbase(), pptr()), ec);
+            if (ec) return -1;
+
+            pbump(static_cast<int>(pbase() - pptr()));
+        }
+        return 0;
+    }
+
+private:
+    void put(boost::string_view s)
+    {
+        sputn(s.data(), static_cast<std::streamsize>(s.size()));
+    }
+
+    void put_status_line(int code)
+    {
+        boost::string_view line = status_line(code);
+        if (line.empty()) {
+            put("HTTP/1.1 ");
+            put_decimal(code);
+            put(" OK\r\n");     // the reason response::status() falls back to
+        } else {
+            put(line);
+        }
+    }
+
+    void put_decimal(std::streamsize n)
+    {
+        // the magnitude is unsigned, so that the most negative value has one too
+        unsigned long long u = n < 0 ? 0ULL - static_cast<unsigned long long>(n) : static_cast<unsigned long long>(n);
+        char digits[24];
+        char* p = digits + sizeof(digits);
+        do {
+            *--p = static_cast<char>('0' + u % 10);
+            u /= 10;
+        } while (u > 0);
+        if (n < 0) *--p = '-';
+        sputn(p, digits + sizeof(digits) - p);
+    }
+
+    static constexpr std::streamsize bufferSize = 16 * 1024;
+    std::array<char, bufferSize> inBuffer_, outBuffer_;
+    std::streamsize remained_;
+    bool continuePending_;
+};
+
+template <class Stream>
+class basic_socket_streambuf : public socket_streambuf_base
+{
+public:
+    basic_socket_streambuf(Stream& stream, boost::asio::yield_context yield)
+        : stream_(stream), yield_(yield) {}
+
+    boost::asio::yield_context* coroutine() override { return &yield_; }
+
+protected:
+    std::size_t read_some(char* data, std::size_t size, boost::system::error_code& ec) override
+    {
+        return stream_.async_read_some(boost::asio::buffer(data, size), yield_[ec]);
+    }
+
+    void write(const char* data, std::size_t size, boost::system::error_code& ec) override
+    {
+        boost::asio::async_write(stream_, boost::asio::buffer(data, size), yield_[ec]);
+    }
+
+private:
+    Stream& stream_;
+    boost::asio::yield_context yield_;
+};
+
+using socket_streambuf = basic_socket_streambuf<boost::asio::ip::tcp::socket>;
+
+class utils
+{
+public:
+    static std::string simple_response_entity(int code, const std::string& status)
+    {
+        std::stringstream ss;
+        ss << "<html>"
+           << "<head><title>" << status << "</title></head>"
+           << "<body><h1>" << code << " " << status << "</h1></body>"
+           << "</html>";
+
+        return std::move(ss.str());
+    }
+
+    static void parase_uri(const std::string& uri, std::string& path, std::map<std::string, std::string>& parameters)
+    {
+        auto pos = uri.find_first_of('?');
+        path = detail::utils::decode_percent_encoding(uri.substr(0, pos));
+        if (pos != std::string::npos) {
+            detail::utils::parse_parameter(uri.substr(pos + 1), parameters);
+        }
+    }
+
+    static void parse_parameter(const std::string& src, std::map<std::string, std::string>& parameters)
+    {
+        std::vector<std::string> splitted;
+        boost::algorithm::split(splitted, src, boost::is_any_of("&"));
+        for (auto p : splitted) {
+            auto pos = p.find_first_of('=');
+            parameters[p.substr(0, pos)] = pos != std::string::npos ? detail::utils::decode_percent_encoding(p.substr(pos + 1)) : "";
+        }
+    }
+
+    static std::string decode_percent_encoding(const std::string& src)
+    {
+        std::string result(src.size(), '\0');
+        result.resize(decode_percent_encoding(src, &result[0]));
+        return std::move(result);
+    }
+
+    // Writes at most src.size() bytes to 'out'; returns the decoded length.
+    static std::size_t decode_percent_encoding(boost::string_view src, char* out)
+    {
+        char* p = out;
+        char hex[3];
+
+        for (auto it = src.begin(); it != src.end(); ++it) {
+            if (*it == '%') {
+                if (++it == src.end()) break;
+                hex[0] = *it;
+                if (++it == src.end()) break;
+                hex[1] = *it;
+                hex[2] = '\0';
+                *p++ = static_cast<char>(std::strtol(hex, nullptr, 16));
+            } else {
+                *p++ = *it;
+            }
+        }
+        return p - out;
+    }
+
+    static boost::string_view trim(boost::string_view s)
+    {
+        s.remove_prefix(std::min(s.find_first_not_of(" \t\r\n"), s.size()));
+        s.remove_suffix(s.size() - std::min(s.find_last_not_of(" \t\r\n") + 1, s.size()));
+        return s;
+    }
+
+    // Accepts both the standard and the URL-safe alphabet; padding is optional.
+    static std::string decode_base64(const std::string& src)
+    {
+        std::string result;
+        unsigned int buffer = 0;
+        int bits = 0;
+
+        for (char c : src) {
+            int value;
+            if (c >= 'A' && c <= 'Z') value = c - 'A';
+            else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') value = c - '0' + 52;
+            else if (c == '+' || c == '-') value = 62;
+            else if (c == '/' || c == '_') value = 63;
+            else continue;
+
+            buffer = (buffer << 6) | value;
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                result.push_back(static_cast<char>((buffer >> bits) & 0xff));
+            }
+        }
+        return result;
+    }
+
+    static std::string encode_base64(const std::string& src)
+    {
+        static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string result;
+        unsigned int buffer = 0;
+        int bits = 0;
+
+        for (char c : src) {
+            buffer = (buffer << 8) | static_cast<unsigned char>(c);
+            bits += 8;
+            while (bits >= 6) {
+                bits -= 6;
+                result.push_back(table[(buffer >> bits) & 0x3f]);
+            }
+        }
+        if (bits > 0) result.push_back(table[(buffer << (6 - bits)) & 0x3f]);
+        while (result.size() % 4 != 0) result.push_back('=');
+        return result;
+    }
+
+    // 20-byte digest; only used for the WebSocket handshake.
+    static std::string sha1(const std::string& src)
+    {
+        std::uint32_t h[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+        std::string data = src;
+        data.push_back('\x80');
+        while (data.size() % 64 != 56) data.push_back('\0');
+        std::uint64_t bits = static_cast<std::uint64_t>(src.size()) * 8;
+        for (int i = 7; i >= 0; i--) data.push_back(static_cast<char>(bits >> (i * 8)));
+
+        auto rotl = [](std::uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+        for (std::size_t block = 0; block < data.size(); block += 64) {
+            std::uint32_t w[80];
+            for (int i = 0; i < 16; i++) {
+                const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data() + block + i * 4);
+                w[i] = (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | p[3];
+            }
+            for (int i = 16; i < 80; i++) w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+            std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; i++) {
+                std::uint32_t f, k;
+                if (i < 20) { f = (b & c) | (~b & d); k = 0x5a827999; }
+                else if (i < 40) { f = b ^ c ^ d; k = 0x6ed9eba1; }
+                else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8f1bbcdc; }
+                else { f = b ^ c ^ d; k = 0xca62c1d6; }
+
+                std::uint32_t t = rotl(a, 5) + f + e + k + w[i];
+                e = d; d = c; c = rotl(b, 30); b = a; a = t;
+            }
+            h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+        }
+
+        std::string result;
+        for (auto v : h) {
+            for (int i = 3; i >= 0; i--) result.push_back(static_cast<char>(v >> (i * 8)));
+        }
+        return result;
+    }
+
+    // XORs a WebSocket payload with its masking key, 8 bytes at a time (vectorized by the compiler).
+    static void apply_mask(char* data, std::size_t size, const unsigned char (&key)[4])
+    {
+        unsigned char repeated[8] = { key[0], key[1], key[2], key[3], key[0], key[1], key[2], key[3] };
+        std::uint64_t key64;
+        std::memcpy(&key64, repeated, sizeof(key64));
+
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            word ^= key64;
+            std::memcpy(data + i, &word, sizeof(word));
+        }
+        for (; i < size; i++) data[i] ^= key[i % 4];
+    }
+
+    // Rejects overlong forms, surrogates and code points beyond U+10FFFF.
+    static bool is_valid_utf8(const char* data, std::size_t size)
+    {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+        const unsigned char* end = p + size;
+
+        while (p < end) {
+            if (*p < 0x80) {
+                p++;
+                continue;
+            }
+
+            std::size_t n;
+            std::uint32_t cp, min;
+            if ((*p & 0xe0) == 0xc0) { n = 1; cp = *p & 0x1f; min = 0x80; }
+            else if ((*p & 0xf0) == 0xe0) { n = 2; cp = *p & 0x0f; min = 0x800; }
+            else if ((*p & 0xf8) == 0xf0) { n = 3; cp = *p & 0x07; min = 0x10000; }
+            else return false;
+
+            if (static_cast<std::size_t>(end - p) <= n) return false;
+            for (std::size_t i = 1; i <= n; i++) {
+                if ((p[i] & 0xc0) != 0x80) return false;
+                cp = (cp << 6) | (p[i] & 0x3f);
+            }
+            if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) return false;
+            p += n + 1;
+        }
+        return true;
+    }
+
+    // Compares the media type of a Content-Type value, ignoring parameters such as charset.
+    static bool is_media_type(const std::string& contentType, const std::string& mediaType)
+    {
+        return boost::algorithm::iequals(boost::algorithm::trim_copy(contentType.substr(0, contentType.find(';'))), mediaType);
+    }
+
+    static std::string extension_to_mime_type(const std::string& extension)
+    {
+        static const std::map<std::string, std::string> table = {{"gif", "image/gif"}, {"htm", "text/html"}, {"html", "text/html"}, {"jpg", "image/jpeg"}, {"jpeg", "image/jpeg"}, {"txt", "text/plain"}, {"png", "image/png"}};
+
+        auto it = table.find(extension.front()=='.' ? extension.substr(1) : extension);
+        return it != table.end() ? it->second : "text/plain";
+    }
+};
+
+// Bump allocator for the parsed data of a request. Nothing is freed piecemeal; reset() makes all memory,
+// including blocks added when the inline one overflowed, available again for the next request.
+class monotonic_arena
+{
+public:
+    monotonic_arena(const monotonic_arena&) = delete;
+    monotonic_arena& operator=(const monotonic_arena&) = delete;
+
+    monotonic_arena() { reset(); }
+
+    void* allocate(std::size_t size, std::size_t alignment)
+    {
+        void* p = std::align(alignment, size, current_, remaining_);
+        if (!p) {
+            next_block(size + alignment);
+            p = std::align(alignment, size, current_, remaining_);
+        }
+        current_ = static_cast<char*>(p) + size;
+        remaining_ -= size;
+        return p;
+    }
+
+    // Returns the unused end of the latest allocation [p, p + size) to the arena.
+    void shrink(void* p, std::size_t size, std::size_t used)
+    {
+        if (static_cast<char*>(p) + size != current_) return;
+        current_ = static_cast<char*>(p) + used;
+        remaining_ += size - used;
+    }
+
+    boost::string_view copy(boost::string_view s)
+    {
+        if (s.empty()) return boost::string_view();
+
+        char* p = static_cast<char*>(allocate(s.size(), 1));
+        std::memcpy(p, s.data(), s.size());
+        return boost::string_view(p, s.size());
+    }
+
+    void reset()
+    {
+        nextBlock_ = 0;
+        current_ = initial_.data();
+        remaining_ = initial_.size();
+    }
+
+private:
+    // room for the header span of an HTTP/1.1 request and the views into it, without a block from the heap
+    static constexpr std::size_t initial_size = max_header_size + 4 * 1024;
+    static constexpr std::size_t block_size = 16 * 1024;
+
+    void next_block(std::size_t size)
+    {
+        if (nextBlock_ == blocks_.size() || blocks_[nextBlock_].second < size) {
+            std::size_t n = size > block_size ? size : block_size;
+            blocks_.emplace(blocks_.begin() + nextBlock_, std::unique_ptr<char[]>(new char[n]), n);
+        }
+        current_ = blocks_[nextBlock_].first.get();
+        remaining_ = blocks_[nextBlock_].second;
+        nextBlock_++;
+    }
+
+    std::array<char, initial_size> initial_;
+    std::vector<std::pair<std::unique_ptr<char[]>, std::size_t>> blocks_;
+    std::size_t nextBlock_;
+    void* current_;
+    std::size_t remaining_;
+};
+
+template <class T>
+class arena_allocator
+{
+public:
+    using value_type = T;
+
+    explicit arena_allocator(monotonic_arena& arena) : arena_(&arena) {}
+    template <class U> arena_allocator(const arena_allocator<U>& other) : arena_(other.arena()) {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, std::size_t) {}
+
+    monotonic_arena* arena() const { return arena_; }
+
+    template <class U> bool operator==(const arena_allocator<U>& other) const { return arena_ == other.arena(); }
+    template <class U> bool operator!=(const arena_allocator<U>& other) const { return arena_ != other.arena(); }
+
+private:
+    monotonic_arena* arena_;
+};
+
+using view_pair = std::pair<boost::string_view, boost::string_view>;
+using view_list = std::vector<view_pair, arena_allocator<view_pair>>;
+
+class handler_table
+{
+public:
+    handler_table() {}
+
+    void set_get_handler(const std::string& name, handler h) { getHandlers_[name] = h; }
+    void set_post_handler(const std::string& name, handler h) { postHandlers_[name] = h; }
+    void set_put_handler(const std::string& name, handler h) { putHandlers_[name] = h; }
+    void set_websocket_handler(const std::string& name, websocket_handler h) { websocketHandlers_[name] = h; }
+
+    handler get_handler(boost::string_view name, handler def = empty_handler) const { return find_handler(getHandlers_, def, name); }
+    handler post_handler(boost::string_view name, handler def = empty_handler) const { return find_handler(postHandlers_, def, name); }
+    handler put_handler(boost::string_view name, handler def = empty_handler) const { return find_handler(putHandlers_, def, name); }
+
+    // Returns an empty function when 'name' accepts no WebSocket.
+    websocket_handler lookup_websocket_handler(boost::string_view name) const
+    {
+        auto it = websocketHandlers_.find(name);
+        return it != websocketHandlers_.end() ? it->second : websocket_handler();
+    }
+
+    static void empty_handler(request&, response&) {}
+private:
+    // std::less<> looks up the request path without constructing a std::string.
+    static handler find_handler(const std::map<std::string, handler, std::less<>>& handlers, const handler def, boost::string_view name)
+    {
+        auto it = handlers.find(name);
+        return (it != handlers.end() ? it->second : def);
+    }
+
+    std::map<std::string, handler, std::less<>> getHandlers_, postHandlers_, putHandlers_;
+    std::map<std::string, websocket_handler, std::less<>> websocketHandlers_;
+};
+
+using header_field = std::pair<std::string, std::string>;
+using header_list = std::vector<header_field>;
+
+class huffman
+{
+public:
+    // RFC 7541 Appendix B; a string ends with at most 7 bits of EOS prefix (all ones).
+    static bool decode(const unsigned char* data, std::size_t size, std::string& result)
+    {
+        const std::vector<node>& tree = decoding_tree();
+
+        std::size_t current = 0;
+        int paddingBits = 0;
+        bool paddingOnes = true;
+        for (std::size_t i = 0; i < size; i++) {
+            for (int bit = 7; bit >= 0; bit--) {
+                int b = (data[i] >> bit) & 1;
+                current = tree[current].children[b];
+                if (current == 0) return false;
+                paddingBits++;
+                paddingOnes = paddingOnes && b;
+
+                if (tree[current].symbol >= 0) {
+                    if (tree[current].symbol == 256) return false;
+                    result.push_back(static_cast<char>(tree[current].symbol));
+                    current = 0;
+                    paddingBits = 0;
+                    paddingOnes = true;
+                }
+            }
+        }
+        return paddingBits <= 7 && paddingOnes;
+    }
+
+private:
+    struct node
+    {
+        std::size_t children[2];
+        int symbol;
+    };
+
+    static const std::vector<node>& decoding_tree()
+    {
+        static const std::vector<node> tree = build_tree();
+        return tree;
+    }
+
+    static std::vector<node> build_tree()
+    {
+        static const std::uint32_t codes[257] = {
+            0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+            0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+            0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+            0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+            0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+            0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+            0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+            0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+            0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+            0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+            0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+            0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+            0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+            0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+            0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+            0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+            0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+            0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+            0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+            0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+            0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+            0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+            0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+            0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+            0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+            0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+            0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+            0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+            0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+            0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+            0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+            0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+            0x3fffffff,
+        };
+        static const std::uint8_t lengths[257] = {
+            13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+            28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+            6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+            5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+            13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+            7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+            15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+            6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+            20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+            24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+            22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+            21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+            26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+            19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+            20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+            26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+            30,
+        };
+
+        std::vector<node> tree(1, node{{0, 0}, -1});
+        for (int symbol = 0; symbol < 257; symbol++) {
+            std::size_t current = 0;
+            for (int bit = lengths[symbol] - 1; bit >= 0; bit--) {
+                int b = (codes[symbol] >> bit) & 1;
+                if (tree[current].children[b] == 0) {
+                    tree[current].children[b] = tree.size();
+                    tree.push_back(node{{0, 0}, -1});
+                }
+                current = tree[current].children[b];
+            }
+            tree[current].symbol = symbol;
+        }
+        return tree;
+    }
+};
+
+class hpack_table
+{
+public:
+    static constexpr std::size_t static_table_size = 61;
+    static constexpr std::size_t default_max_size = 4096;
+
+    hpack_table() : size_(0), maxSize_(default_max_size) {}
+
+    static const header_field& static_entry(std::size_t index)
+    {
+        static const header_field table[static_table_size] = {
+            {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"}, {":path", "/index.html"},
+            {":scheme", "http"}, {":scheme", "https"}, {":status", "200"}, {":status", "204"}, {":status", "206"},
+            {":status", "304"}, {":status", "400"}, {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+            {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""}, {"access-control-allow-origin", ""},
+            {"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""}, {"content-disposition", ""},
+            {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""}, {"content-location", ""}, {"content-range", ""},
+            {"content-type", ""}, {"cookie", ""}, {"date", ""}, {"etag", ""}, {"expect", ""},
+            {"expires", ""}, {"from", ""}, {"host", ""}, {"if-match", ""}, {"if-modified-since", ""},
+            {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""}, {"last-modified", ""}, {"link", ""},
+            {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""}, {"proxy-authorization", ""}, {"range", ""},
+            {"referer", ""}, {"refresh", ""}, {"retry-after", ""}, {"server", ""}, {"set-cookie", ""},
+            {"strict-transport-security", ""}, {"transfer-encoding", ""}, {"user-agent", ""}, {"vary", ""}, {"via", ""},
+            {"www-authenticate", ""}
+        };
+        return table[index - 1];
+    }
+
+    // 1-based index over the static table followed by the dynamic table (newest first).
+    const header_field* get(std::size_t index) const
+    {
+        if (index == 0) return nullptr;
+        if (index <= static_table_size) return &static_entry(index);
+        index -= static_table_size + 1;
+        return index < entries_.size() ? &entries_[index] : nullptr;
+    }
+
+    // Returns the index of an exact match, or of a name-only match with 'nameOnly' set; 0 if none.
+    std::size_t find(const header_field& field, bool& nameOnly) const
+    {
+        std::size_t nameIndex = 0;
+        for (std::size_t i = 1; i <= static_table_size; i++) {
+            const header_field& e = static_entry(i);
+            if (e.first != field.first) continue;
+            if (e.second == field.second) {
+                nameOnly = false;
+                return i;
+            }
+            if (nameIndex == 0) nameIndex = i;
+        }
+        for (std::size_t i = 0; i < entries_.size(); i++) {
+            if (entries_[i].first != field.first) continue;
+            if (entries_[i].second == field.second) {
+                nameOnly = false;
+                return static_table_size + 1 + i;
+            }
+            if (nameIndex == 0) nameIndex = static_table_size + 1 + i;
+        }
+        nameOnly = true;
+        return nameIndex;
+    }
+
+    void add(const header_field& field)
+    {
+        std::size_t size = entry_size(field);
+        evict(size > maxSize_ ? maxSize_ : maxSize_ - size);
+        if (size > maxSize_) return;
+
+        entries_.push_front(field);
+        size_ += size;
+    }
+
+    std::size_t max_size() const { return maxSize_; }
+
+    void set_max_size(std::size_t n)
+    {
+        maxSize_ = n;
+        evict(maxSize_);
+    }
+
+private:
+    static std::size_t entry_size(const header_field& field) { return field.first.size() + field.second.size() + 32; }
+
+    void evict(std::size_t limit)
+    {
+        while (size_ > limit && !entries_.empty()) {
+            size_ -= entry_size(entries_.back());
+            entries_.pop_back();
+        }
+    }
+
+    std::deque<header_field> entries_;
+    std::size_t size_;
+    std::size_t maxSize_;
+};
+
+class hpack_decoder
+{
+public:
+    // 'data' is one complete header block; the dynamic table is shared by all streams of the connection.
+    bool decode(const unsigned char* data, std::size_t size, header_list& headers)
+    {
+        bool overflow = false;
+        return decode(data, size, headers, std::numeric_limits<std::size_t>::max(), overflow);
+    }
+
+    // Fields beyond 'maxListSize' (counted as name + value + 32, RFC 7540 6.5.2) are dropped and reported by 'overflow';
+    // the whole block is still decoded to keep the dynamic table in step with the peer's encoder.
+    bool decode(const unsigned char* data, std::size_t size, header_list& headers, std::size_t maxListSize, bool& overflow)
+    {
+        const unsigned char* p = data;
+        const unsigned char* end = data + size;
+        std::size_t listSize = 0;
+        auto emit = [&](header_field field) {
+            listSize += field.first.size() + field.second.size() + 32;
+            if (listSize > maxListSize) {
+                overflow = true;
+                headers.clear();
+            } else {
+                headers.push_back(std::move(field));
+            }
+        };
+
+        while (p != end) {
+            std::uint64_t index;
+            if (*p & 0x80) {
+                if (!decode_integer(p, end, 7, index)) return false;
+                const header_field* field = table_.get(static_cast<std::size_t>(index));
+                if (!field) return false;
+                emit(*field);
+            } else if ((*p & 0xe0) == 0x20) {
+                if (!decode_integer(p, end, 5, index) || index > hpack_table::default_max_size) return false;
+                table_.set_max_size(static_cast<std::size_t>(index));
+            } else {
+                bool indexing = (*p & 0xc0) == 0x40;
+                if (!decode_integer(p, end, indexing ? 6 : 4, index)) return false;
+
+                header_field field;
+                if (index != 0) {
+                    const header_field* name = table_.get(static_cast<std::size_t>(index));
+                    if (!name) return false;
+                    field.first = name->first;
+                } else if (!decode_string(p, end, field.first)) {
+                    return false;
+                }
+                if (!decode_string(p, end, field.second)) return false;
+
+                if (indexing) table_.add(field);
+                emit(std::move(field));
+            }
+        }
+        return true;
+    }
+
+    static bool decode_integer(const unsigned char*& p, const unsigned char* end, int prefixBits, std::uint64_t& value)
+    {
+        if (p == end) return false;
+
+        const std::uint64_t prefixMax = (1u << prefixBits) - 1;
+        value = *p++ & prefixMax;
+        if (value < prefixMax) return true;
+
+        for (int shift = 0; p != end && shift <= 28; shift += 7) {
+            unsigned char b = *p++;
+            value += static_cast<std::uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    static bool decode_string(const unsigned char*& p, const unsigned char* end, std::string& result)
+    {
+        if (p == end) return false;
+
+        bool huffmanCoded = (*p & 0x80) != 0;
+        std::uint64_t length;
+        if (!decode_integer(p, end, 7, length) || length > static_cast<std::uint64_t>(end - p)) return false;
+
+        if (huffmanCoded) {
+            if (!huffman::decode(p, static_cast<std::size_t>(length), result)) return false;
+        } else {
+            result.assign(reinterpret_cast<const char*>(p), static_cast<std::size_t>(length));
+        }
+        p += length;
+        return true;
+    }
+
+private:
+    hpack_table table_;
+};
+
+class hpack_encoder
+{
+public:
+    hpack_encoder() : sizeUpdatePending_(false) {}
+
+    // Called with the peer's SETTINGS_HEADER_TABLE_SIZE; never grows beyond the default 4096.
+    void set_max_table_size(std::size_t n)
+    {
+        if (n > hpack_table::default_max_size) n = hpack_table::default_max_size;
+        if (n == table_.max_size()) return;
+
+        table_.set_max_size(n);
+        sizeUpdatePending_ = true;
+    }
+
+    // Strings are sent as raw literals; repeated fields are indexed so later responses cost a byte each.
+    void encode(const header_list& headers, std::string& out)
+    {
+        if (sizeUpdatePending_) {
+            encode_integer(out, 0x20, 5, table_.max_size());
+            sizeUpdatePending_ = false;
+        }
+
+        for (auto& field : headers) {
+            bool nameOnly = false;
+            std::size_t index = table_.find(field, nameOnly);
+            if (index != 0 && !nameOnly) {
+                encode_integer(out, 0x80, 7, index);
+                continue;
+            }
+
+            // values that change on every response would only churn the dynamic table
+            bool indexing = field.first != "content-length" && field.first != "date";
+            encode_integer(out, indexing ? 0x40 : 0x00, indexing ? 6 : 4, index);
+            if (index == 0) encode_string(out, field.first);
+            encode_string(out, field.second);
+
+            if (indexing) table_.add(field);
+        }
+    }
+
+    static void encode_integer(std::string& out, unsigned char pattern, int prefixBits, std::uint64_t value)
+    {
+        const std::uint64_t prefixMax = (1u << prefixBits) - 1;
+        if (value < prefixMax) {
+            out.push_back(static_cast<char>(pattern | value));
+            return;
+        }
+
+        out.push_back(static_cast<char>(pattern | prefixMax));
+        for (value -= prefixMax; value >= 0x80; value >>= 7) {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    static void encode_string(std::string& out, const std::string& s)
+    {
+        encode_integer(out, 0x00, 7, s.size());
+        out.append(s);
+    }
+
+private:
+    hpack_table table_;
+    bool sizeUpdatePending_;
+};
+
+#ifdef BOOST_ASIO_HTTP_USE_SSL
+class session_ticket_keys
+{
+public:
+    session_ticket_keys(const session_ticket_keys&) = delete;
+    session_ticket_keys& operator=(const session_ticket_keys&) = delete;
+
+    struct key
+    {
+        unsigned char name[16];
+        unsigned char aesKey[32];
+        unsigned char hmacKey[32];
+    };
+
+    explicit session_ticket_keys(std::chrono::seconds rotation)
+        : rotation_(rotation), rotated_(std::chrono::steady_clock::now())
+    {
+        for (auto& k : keys_) generate(k);
+    }
+
+    ~session_ticket_keys() { OPENSSL_cleanse(keys_.data(), sizeof(keys_)); }
+
+    // keys_[0] encrypts new tickets, keys_[1] is the previous key still accepted for decryption.
+    key current()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rotate_if_expired();
+        return keys_[0];
+    }
+
+    bool find(const unsigned char* name, key& result, bool& renew)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rotate_if_expired();
+        for (std::size_t i = 0; i < keys_.size(); i++) {
+            if (std::memcmp(keys_[i].name, name, sizeof(keys_[i].name)) == 0) {
+                result = keys_[i];
+                renew = (i != 0);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static int ex_data_index()
+    {
+        static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+        return index;
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    static int callback(SSL* ssl, unsigned char* name, unsigned char* iv, EVP_CIPHER_CTX* cipher, EVP_MAC_CTX* mac, int enc)
+#else
+    static int callback(SSL* ssl, unsigned char* name, unsigned char* iv, EVP_CIPHER_CTX* cipher, HMAC_CTX* mac, int enc)
+#endif
+    {
+        auto keys = static_cast<session_ticket_keys*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ex_data_index()));
+        if (!keys) return -1;
+
+        key k;
+        bool renew = false;
+        if (enc) {
+            k = keys->current();
+            std::memcpy(name, k.name, sizeof(k.name));
+            if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1) return -1;
+            if (EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, k.aesKey, iv) != 1) return -1;
+        } else {
+            if (!keys->find(name, k, renew)) return 0;  // unknown or expired key: fall back to a full handshake
+            if (EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, k.aesKey, iv) != 1) return -1;
+        }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        OSSL_PARAM params[] = {
+            OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, k.hmacKey, sizeof(k.hmacKey)),
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char*>("SHA256"), 0),
+            OSSL_PARAM_construct_end()
+        };
+        if (EVP_MAC_CTX_set_params(mac, params) != 1) return -1;
+#else
+        if (HMAC_Init_ex(mac, k.hmacKey, sizeof(k.hmacKey), EVP_sha256(), nullptr) != 1) return -1;
+#endif
+        OPENSSL_cleanse(&k, sizeof(k));
+
+        // 2 asks OpenSSL to issue a fresh ticket; TLS 1.3 clients need one after every resumption.
+        return (renew || SSL_version(ssl) >= TLS1_3_VERSION) ? 2 : 1;
+    }
+
+private:
+    void rotate_if_expired()
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now - rotated_ < rotation_) return;
+
+        if (now - rotated_ < rotation_ * 2) {
+            keys_[1] = keys_[0];
+        } else {
+            generate(keys_[1]);
+        }
+        generate(keys_[0]);
+        rotated_ = now;
+    }
+
+    static void generate(key& k)
+    {
+        if (RAND_bytes(reinterpret_cast<unsigned char*>(&k), sizeof(k)) != 1) {
+            throw std::runtime_error("RAND_bytes failed");
+        }
+    }
+
+    std::mutex mutex_;
+    std::array<key, 2> keys_;
+    std::chrono::seconds rotation_;
+    std::chrono::steady_clock::time_point rotated_;
+};
+#endif
+
+}   // namespace boost_asio_http::detail
+
+#ifdef BOOST_ASIO_HTTP_USE_SSL
+class ssl_context
+{
+public:
+    ssl_context(const ssl_context&) = delete;
+    ssl_context& operator=(const ssl_context&) = delete;
+
+    explicit ssl_context(boost::asio::ssl::context::method method = boost::asio::ssl::context::tls_server)
+        : context_(method)
+    {
+        context_.set_options(boost::asio::ssl::context::default_workarounds
+                           | boost::asio::ssl::context::no_sslv2
+                           | boost::asio::ssl::context::no_sslv3
+                           | boost::asio::ssl::context::no_tlsv1
+                           | boost::asio::ssl::context::no_tlsv1_1);
+    }
+
+    boost::asio::ssl::context& native() { return context_; }
+
+    void use_certificate_chain_file(const std::string& path) { context_.use_certificate_chain_file(path); }
+    void use_private_key_file(const std::string& path) { context_.use_private_key_file(path, boost::asio::ssl::context::pem); }
+
+    // Sessions are kept on the server for 'timeout', so that reconnecting clients can resume
+    // by session ID (TLS 1.2) or by a stateful ticket (TLS 1.3 with tickets disabled).
+    void set_session_cache(std::size_t size, std::chrono::seconds timeout)
+    {
+        static const unsigned char sessionIdContext[] = "boost_asio_http";
+
+        SSL_CTX* ctx = context_.native_handle();
+        SSL_CTX_set_session_id_context(ctx, sessionIdContext, sizeof(sessionIdContext) - 1);
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(ctx, static_cast<long>(size));
+        SSL_CTX_set_timeout(ctx, static_cast<long>(timeout.count()));
+    }
+
+    // Stateless resumption; the ticket key is replaced every 'rotation' and the previous
+    // key is still accepted for one more period, so a ticket lives between 1x and 2x 'rotation'.
+    void enable_session_tickets(std::chrono::seconds rotation)
+    {
+        SSL_CTX* ctx = context_.native_handle();
+        ticketKeys_.reset(new detail::session_ticket_keys(rotation));
+        SSL_CTX_set_ex_data(ctx, detail::session_ticket_keys::ex_data_index(), ticketKeys_.get());
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, &detail::session_ticket_keys::callback);
+#else
+        SSL_CTX_set_tlsext_ticket_key_cb(ctx, &detail::session_ticket_keys::callback);
+#endif
+        SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+    }
+
+    void disable_session_tickets() { SSL_CTX_set_options(context_.native_handle(), SSL_OP_NO_TICKET); }
+
+private:
+    boost::asio::ssl::context context_;
+    std::unique_ptr<detail::session_ticket_keys> ticketKeys_;
+};
+#endif
+
+namespace detail {
+
+struct no_context {};
+
+template <class Stream>
+struct stream_traits
+{
+    using context_type = no_context;
+
+    static Stream create(boost::asio::ip::tcp::socket socket, context_type&) { return Stream(std::move(socket)); }
+    static void handshake(Stream&, boost::asio::yield_context, boost::system::error_code&) {}
+    static void shutdown(Stream&, boost::asio::yield_context, boost::system::error_code&) {}
+    static void close(Stream& stream)
+    {
+        boost::system::error_code ec;
+        stream.close(ec);
+    }
+
+    static constexpr bool cleartext_http2 = true;
+};
+
+#ifdef BOOST_ASIO_HTTP_USE_SSL
+template <class Socket>
+struct stream_traits<boost::asio::ssl::stream<Socket>>
+{
+    using stream_type = boost::asio::ssl::stream<Socket>;
+    using context_type = ssl_context;
+
+    static stream_type create(boost::asio::ip::tcp::socket socket, context_type& context)
+    {
+        boost::system::error_code ec;
+        socket.set_option(boost::asio::ip::tcp::no_delay(true), ec);   // close_notify follows the response as a separate small write
+        return stream_type(std::move(socket), context.native());
+    }
+
+    static void handshake(stream_type& stream, boost::asio::yield_context yield, boost::system::error_code& ec)
+    {
+        stream.async_handshake(boost::asio::ssl::stream_base::server, yield[ec]);
+    }
+
+    // close_notify keeps the session resumable; don't wait long for the peer's reply.
+    static void shutdown(stream_type& stream, boost::asio::yield_context yield, boost::system::error_code& ec)
+    {
+        boost::asio::steady_timer timer(stream.get_executor(), std::chrono::seconds(1));
+        timer.async_wait([&stream](boost::system::error_code ec) {
+            if (!ec) stream.lowest_layer().cancel(ec);
+        });
+        stream.async_shutdown(yield[ec]);
+        timer.cancel();
+    }
+
+    static void close(stream_type& stream)
+    {
+        boost::system::error_code ec;
+        stream.lowest_layer().close(ec);
+    }
+
+    static constexpr bool cleartext_http2 = false;     // HTTP/2 over TLS needs ALPN
+};
+#endif
+
+template <class Stream>
+class http2_session;
+
+class response_cache;
+
+class connection_base
+{
+public:
+    virtual ~connection_base() {}
+
+    virtual void start() = 0;
+    virtual void stop() = 0;
+};
+
+typedef std::shared_ptr<connection_base> connection_ptr;
+
+class connection_manager
+{
+public:
+    connection_manager(const connection_manager&) = delete;
+    connection_manager& operator=(const connection_manager&) = delete;
+
+    connection_manager() {}
+
+    void start(connection_ptr c)
+    {
+        connections_.insert(c);
+        c->start();
+    }
+
+    void stop(connection_ptr c)
+    {
+        connections_.erase(c);
+        c->stop();
+    }
+
+    void stop_all()
+    {
+        for (auto c : connections_) c->stop();
+        connections_.clear();
+    }
+private:
+    std::set<connection_ptr> connections_;
+};
+
+template <class Stream>
+class basic_connection : public connection_base, public std::enable_shared_from_this<basic_connection<Stream>>
+{
+public:
+    basic_connection(const basic_connection&) = delete;
+    basic_connection& operator=(const basic_connection&) = delete;
+
+    explicit basic_connection(boost::asio::io_context& ioContext, Stream stream, connection_manager& manager, const std::string& docRoot, handler_table& handlers)
+        : strand_(ioContext.get_executor()), stream_(std::move(stream)), connectionManager_(manager), docRoot_(docRoot), handlerTable_(handlers) {}
+
+    void start() override { do_process(); }
+    void stop() override { stream_traits<Stream>::close(stream_); }
+
+private:
+    void do_process();
+    handler select_handler(const request& rq);
+    void default_get_handler(request& rq, response& rs);
+    void default_post_handler(request& rq, response& rs);
+    void default_put_handler(request& rq, response& rs);
+
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+    Stream stream_;
+    connection_manager& connectionManager_;
+    std::string docRoot_;
+    handler_table& handlerTable_;
+    monotonic_arena arena_;
+};
+
+using connection = basic_connection<boost::asio::ip::tcp::socket>;
+
+}   // namespace boost_asio_http::detail
+
+class request
+{
+public:
+    // Sorted by name; views stay valid while the request exists.
+    using parameter_list = detail::view_list;
+
+private:
+    template <class> friend class detail::basic_connection;
+    template <class> friend class detail::http2_session;
+
+    request(detail::socket_streambuf_base* sb, detail::monotonic_arena& arena)
+        : arena_(arena), is_(sb), headers_(detail::arena_allocator<detail::view_pair>(arena)), parameters_(detail::arena_allocator<detail::view_pair>(arena)),
+          contentLength_(0), formRead_(false), maxFormSize_(detail::default_max_form_size), rejectCode_(0)
+    {
+        // the header block is read into one arena span of the largest accepted size, and the rest is given back;
+        // every field below is a view into it
+        char* block = static_cast<char*>(arena_.allocate(detail::max_header_size, 1));
+        std::size_t size = 0;
+        for (std::size_t lineStart = 0; ; ) {
+            if (size == detail::max_header_size) {
+                rejectCode_ = 431;      // Request Header Fields Too Large
+                size = 0;
+                break;
+            }
+            int c = sb->sbumpc();
+            if (c == std::char_traits<char>::eof()) break;
+
+            block[size++] = static_cast<char>(c);
+            if (c == '\n') {
+                std::size_t length = size - lineStart;
+                if (length == 1 || (length == 2 && block[lineStart] == '\r')) break;
+                lineStart = size;
+            }
+        }
+        arena_.shrink(block, detail::max_header_size, size);
+
+        char* p = block;
+        char* end = p + size;
+        for (int lineno = 0; p < end; lineno++) {
+            char* eol = std::find(p, end, '\n');
+            if (eol == end) break;      // incomplete line
+
+            boost::string_view line(p, eol - p);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty()) break;
+
+            if (lineno == 0) {
+                boost::string_view* fields[] = { &method_, &uri_, &protocol_ };
+                for (auto field : fields) {
+                    line.remove_prefix(std::min(line.find_first_not_of(" \t"), line.size()));
+                    *field = line.substr(0, line.find_first_of(" \t"));
+                    line.remove_prefix(field->size());
+                }
+            } else {
+                auto pos = line.find(':');
+                if (pos != boost::string_view::npos) {
+                    std::transform(p, p + pos, p, [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+                    add_header(line.substr(0, pos), detail::utils::trim(line.substr(pos + 1)));
+                }
+            }
+            p = eol + 1;
+        }
+
+        parse_uri();
+
+        if (method_ == "POST" || method_ == "PUT") sb->set_remained_size(contentLength_);
+    }
+
+    // HTTP/2 stream; the body ends with the stream instead of Content-Length.
+    request(detail::socket_streambuf_base* sb, const detail::header_list& headers, detail::monotonic_arena& arena)
+        : arena_(arena), is_(sb), protocol_("HTTP/2"), headers_(detail::arena_allocator<detail::view_pair>(arena)), parameters_(detail::arena_allocator<detail::view_pair>(arena)),
+          contentLength_(0), formRead_(false), maxFormSize_(detail::default_max_form_size), rejectCode_(0)
+    {
+        headers_.reserve(headers.size());
+        for (auto& h : headers) {
+            if (h.first == ":method") {
+                method_ = arena_.copy(h.second);
+            } else if (h.first == ":path") {
+                uri_ = arena_.copy(h.second);
+            } else if (h.first == ":authority") {
+                add_header("host", arena_.copy(h.second));
+            } else if (!h.first.empty() && h.first.front() != ':') {
+                add_header(arena_.copy(h.first), arena_.copy(h.second));
+            }
+        }
+
+        parse_uri();
+    }
+
+    void add_header(boost::string_view name, boost::string_view value)
+    {
+        if (name == "content-length") {
+            // digits only, and a repeated field must agree with the first one
+            bool repeated = std::any_of(headers_.begin(), headers_.end(), [](const detail::view_pair& h) { return h.first == "content-length"; });
+            std::streamsize length = 0;
+            bool valid = !value.empty() && value.size() <= detail::max_content_length_digits;
+            for (std::size_t i = 0; valid && i < value.size(); i++) {
+                valid = value[i] >= '0' && value[i] <= '9';
+                length = length * 10 + (value[i] - '0');
+            }
+            if (valid && (!repeated || length == contentLength_)) {
+                contentLength_ = length;
+            } else {
+                rejectCode_ = 400;      // Bad Request
+                contentLength_ = 0;
+            }
+        } else if (name == "content-type") {
+            contentType_ = value;
+        }
+        headers_.emplace_back(name, value);
+    }
+
+    void parse_uri()
+    {
+        auto pos = uri_.find('?');
+        path_ = decode(uri_.substr(0, pos));
+        if (pos != boost::string_view::npos) parse_parameters(uri_.substr(pos + 1));
+    }
+
+    void parse_parameters(boost::string_view src) const
+    {
+        while (!src.empty()) {
+            auto pos = src.find('&');
+            boost::string_view pair = src.substr(0, pos);
+            src.remove_prefix(pos != boost::string_view::npos ? pos + 1 : src.size());
+            if (pair.empty()) continue;
+
+            auto eq = pair.find('=');
+            set_parameter(pair.substr(0, eq), eq != boost::string_view::npos ? decode(pair.substr(eq + 1)) : boost::string_view());
+        }
+    }
+
+    // Later values replace earlier ones, so the body of a form overrides the URI.
+    void set_parameter(boost::string_view name, boost::string_view value) const
+    {
+        auto it = std::lower_bound(parameters_.begin(), parameters_.end(), name, [](const detail::view_pair& p, boost::string_view n) { return p.first < n; });
+        if (it != parameters_.end() && it->first == name) {
+            it->second = value;
+        } else {
+            parameters_.emplace(it, name, value);
+        }
+    }
+
+    boost::string_view decode(boost::string_view src) const
+    {
+        if (src.find('%') == boost::string_view::npos) return src;
+
+        char* p = static_cast<char*>(arena_.allocate(src.size(), 1));
+        return boost::string_view(p, detail::utils::decode_percent_encoding(src, p));
+    }
+
+    // A urlencoded POST body is parsed on the first parameter access, one pair at a time and up to maxFormSize_ bytes;
+    // a handler reading stream() first sees only the URI parameters.
+    void read_form_parameters() const
+    {
+        if (formRead_) return;
+        formRead_ = true;
+
+        if (method_ != "POST" || !detail::utils::is_media_type(contentType_.to_string(), "application/x-www-form-urlencoded")) return;
+
+        std::streambuf* sb = is_.rdbuf();
+        detail::arena_allocator<char> allocator(arena_);
+        std::vector<char, detail::arena_allocator<char>> pair(allocator);
+        for (std::streamsize n = 0; n < maxFormSize_; n++) {
+            int c = sb->sbumpc();
+            if (c == std::char_traits<char>::eof() || c == '&') {
+                if (!pair.empty()) parse_parameters(arena_.copy(boost::string_view(pair.data(), pair.size())));
+                if (c == std::char_traits<char>::eof()) break;
+                pair.clear();
+            } else {
+                pair.push_back(static_cast<char>(c));
+            }
+        }
+    }
+
+public:
+    std::string method() const { return method_.to_string(); }
+    std::string path() const { return path_.to_string(); }
+    std::string protocol() const { return protocol_.to_string(); }
+
+    std::streamsize content_length() const { return contentLength_; }
+    std::string content_type() const { return contentType_.to_string(); }
+    std::istream& stream() { return is_; }
+
+    // Upper bound of the urlencoded form body parsed into parameters; larger bodies are truncated.
+    void set_max_form_size(std::streamsize n) { maxFormSize_ = n; }
+
+    // 'name' is case-insensitive; returns an empty string for a missing header.
+    std::string header(const std::string& name) const { return header_view(name).to_string(); }
+
+    std::vector<std::string> parameter_names() const
+    {
+        read_form_parameters();
+
+        std::vector<std::string> result;
+        for (auto& e : parameters_) {
+            result.push_back(e.first.to_string());
+        }
+        return result;
+    }
+
+    std::string parameter(const std::string& name) const { return parameter_view(name).to_string(); }
+
+    // Views into the request's arena, valid while the request exists; they avoid the copies made by the accessors above.
+    boost::string_view method_view() const { return method_; }
+    boost::string_view path_view() const { return path_; }
+    boost::string_view protocol_view() const { return protocol_; }
+    boost::string_view content_type_view() const { return contentType_; }
+
+    boost::string_view header_view(boost::string_view name) const
+    {
+        for (auto& h : headers_) {
+            if (boost::algorithm::iequals(h.first, name)) return h.second;
+        }
+        return boost::string_view();
+    }
+
+    const parameter_list& parameters() const
+    {
+        read_form_parameters();
+        return parameters_;
+    }
+
+    boost::string_view parameter_view(boost::string_view name) const
+    {
+        read_form_parameters();
+
+        auto it = std::lower_bound(parameters_.begin(), parameters_.end(), name, [](const detail::view_pair& p, boost::string_view n) { return p.first < n; });
+        return it != parameters_.end() && it->first == name ? it->second : boost::string_view();
+    }
+private:
+    detail::monotonic_arena& arena_;
+    std::istream is_;
+    boost::string_view method_, uri_, path_, protocol_, contentType_;
+    detail::view_list headers_;
+    mutable detail::view_list parameters_;
+    std::streamsize contentLength_;
+    mutable bool formRead_;
+    std::streamsize maxFormSize_;
+    int rejectCode_;    // status of the reply when the request can't be served, or 0
+};
+
+class response
+{
+public:
+    enum code {
+        continue_ = 100, switching_protocols = 101, processing = 102, early_hints = 103,
+        ok = 200, created = 201, accepted = 202, non_authoritative_information = 203, no_content = 204, reset_content = 205, partial_content = 206,
+        multi_status = 207, already_reported = 208, im_used = 226,
+        multiple_choices = 300, moved_permanently = 301, found = 302, see_other = 303, not_modified = 304, use_proxy = 305,
+        temporary_redirect = 307, permanent_redirect = 308,
+        bad_request = 400, unauthorized = 401, payment_required = 402, forbidden = 403, not_found = 404, method_not_allowed = 405,
+        not_acceptable = 406, proxy_authentication_required = 407, request_timeout = 408, conflict = 409, gone = 410,
+        length_required = 411, precondition_failed = 412, content_too_large = 413, uri_too_long = 414, unsupported_media_type = 415,
+        range_not_satisfiable = 416, expectation_failed = 417, misdirected_request = 421, unprocessable_content = 422, locked = 423,
+        failed_dependency = 424, too_early = 425, upgrade_required = 426, precondition_required = 428, too_many_requests = 429,
+        request_header_fields_too_large = 431, unavailable_for_legal_reasons = 451,
+        internal_server_error = 500, not_implemented = 501, bad_gateway = 502, service_unavailable = 503, gateway_timeout = 504,
+        http_version_not_supported = 505, variant_also_negotiates = 506, insufficient_storage = 507, loop_detected = 508,
+        network_authentication_required = 511
+    };
+private:
+    template <class> friend class detail::basic_connection;
+    template <class> friend class detail::http2_session;
+    friend class detail::response_cache;
+
+    response(detail::socket_streambuf_base* sb)
+        : sb_(sb), os_(sb), headerWritten_(false), closed_(false), code_(ok), contentType_("text/html"), contentLength_(detail::uninitialized_content_length)
+    {
+    }
+    void flush_header()
+    {
+        if (headerWritten_) return;
+
+        sb_->write_header(code_, contentType_, contentLength_, fields_);
+
+        headerWritten_ = true;
+    }
+
+    // Unregistered codes keep the "OK" they have always been sent with.
+    static std::string status(code c)
+    {
+        boost::string_view reason = detail::reason_phrase(c);
+        return reason.empty() ? std::string("OK") : reason.to_string();
+    }
+
+    void send(const detail::stored_response& r)
+    {
+        sb_->write_response(r);
+        headerWritten_ = true;
+    }
+
+public:
+    void close()
+    {
+        if (closed_) return;
+
+        flush_header();
+        os_.flush();
+        closed_ = true;
+    }
+
+    void set_code(code code) { code_ = code; }
+    void set_content_type(const std::string& type) { contentType_ = type; }
+    void set_content_length(std::streamsize n)
+    {
+        if (n < 0) throw std::invalid_argument("negative content length");
+        contentLength_ = n;
+    }
+
+    // Replaces any header of the same name. Content-Type and Content-Length go to their setters,
+    // and the framing of the connection (Transfer-Encoding, Connection, ...) can't be changed.
+    // Throws std::logic_error once the header has gone out with stream().
+    void set_header(boost::string_view name, boost::string_view value)
+    {
+        if (!special_header(name, value)) {
+            remove_header(name);
+            append_field(name, value);
+        }
+    }
+
+    // Appends a header even if one of the same name exists, as for Set-Cookie.
+    void add_header(boost::string_view name, boost::string_view value)
+    {
+        if (!special_header(name, value)) append_field(name, value);
+    }
+
+    std::ostream& stream()
+    {
+        flush_header();
+        return os_;
+    }
+
+    void simple_response(code code)
+    {
+        std::string entity = detail::utils::simple_response_entity(code, status(code));
+
+        set_code(code);
+        set_content_length(entity.length());
+        set_content_type("text/html");
+
+        std::ostream& os = stream();
+        os << entity;
+        os.flush();
+    }
+private:
+    // Validates the field, and handles the ones that aren't kept in fields_; false for the others.
+    bool special_header(boost::string_view name, boost::string_view value)
+    {
+        if (headerWritten_) throw std::logic_error("header already sent");
+
+        static const boost::string_view controls("\r\n\0", 3);
+        if (name.empty() || name.find(':') != boost::string_view::npos || name.find_first_of(controls) != boost::string_view::npos || value.find_first_of(controls) != boost::string_view::npos) {
+            throw std::invalid_argument("invalid header field");
+        }
+
+        if (boost::algorithm::iequals(name, "content-type")) {
+            set_content_type(value.to_string());
+        } else if (boost::algorithm::iequals(name, "content-length")) {
+            std::streamsize n = 0;
+            if (value.empty() || value.size() > detail::max_content_length_digits) throw std::invalid_argument("invalid content length");
+            for (char c : value) {
+                if (c < '0' || c > '9') throw std::invalid_argument("invalid content length");
+                n = n * 10 + (c - '0');
+            }
+            set_content_length(n);
+        } else {
+            const char* hopByHop[] = { "transfer-encoding", "connection", "keep-alive", "proxy-connection", "upgrade", "te", "trailer" };
+            for (auto h : hopByHop) {
+                if (boost::algorithm::iequals(name, h)) throw std::invalid_argument("framing header field");
+            }
+            return false;
+        }
+        return true;
+    }
+
+    void append_field(boost::string_view name, boost::string_view value)
+    {
+        fields_.append(name.data(), name.size()).append(": ", 2).append(value.data(), value.size()).append("\r\n", 2);
+    }
+
+    void remove_header(boost::string_view name)
+    {
+        std::size_t pos = 0;
+        while (pos < fields_.size()) {
+            std::size_t next = fields_.find("\r\n", pos) + 2;
+            boost::string_view line(fields_.data() + pos, next - pos);
+            if (line.size() > name.size() && line[name.size()] == ':' && boost::algorithm::iequals(line.substr(0, name.size()), name)) {
+                fields_.erase(pos, next - pos);
+            } else {
+                pos = next;
+            }
+        }
+    }
+
+    detail::socket_streambuf_base* sb_;
+    std::ostream os_;
+    bool headerWritten_;
+    bool closed_;
+    code code_;
+    std::string contentType_;
+    std::streamsize contentLength_;
+    std::string fields_;
+};
+
+namespace detail {
+
+// Shares the output of one GET handler between requests with the same path, parameters and Accept* headers
+// for 'ttl', keeping at most 'maxEntries' responses. Requests with credentials are always passed to the handler.
+// Requests that arrive while the handler is suspended, e.g. reading a request body, wait for its result
+// instead of running it again. Like the connections, a cache is only used from the server's thread.
+class response_cache
+{
+public:
+    response_cache(const response_cache&) = delete;
+    response_cache& operator=(const response_cache&) = delete;
+
+    response_cache(handler h, std::chrono::steady_clock::duration ttl, std::size_t maxEntries)
+        : handler_(h), ttl_(ttl), maxEntries_(maxEntries) {}
+
+    static handler wrap(handler h, std::chrono::steady_clock::duration ttl, std::size_t maxEntries = default_max_cache_entries)
+    {
+        auto cache = std::make_shared<response_cache>(h, ttl, maxEntries);
+        return [cache](request& rq, response& rs) { cache->serve(rq, rs); };
+    }
+
+    void serve(request& rq, response& rs)
+    {
+        // responses to authenticated users are theirs only
+        if (!rq.header_view("authorization").empty() || !rq.header_view("cookie").empty()) {
+            handler_(rq, rs);
+            return;
+        }
+        std::string key = make_key(rq);
+
+        auto now = std::chrono::steady_clock::now();
+        auto it = entries_.find(key);
+        if (it != entries_.end() && !(it->second->ready && it->second->expires <= now)) {
+            std::shared_ptr<entry> e = it->second;
+            boost::asio::yield_context* yield = rs.sb_->coroutine();
+            if (!e->ready && yield) wait(*e, *yield);
+
+            // the handler failed or produced an uncacheable response; answer this request on its own
+            if (!e->ready || !e->stored) {
+                handler_(rq, rs);
+                return;
+            }
+            rs.send(e->response);
+            return;
+        }
+
+        trim(now);
+        auto e = std::make_shared<entry>();
+        entries_[key] = e;
+
+        try {
+            run_handler(rq, *e);
+        } catch (...) {
+            publish(key, e);
+            throw;
+        }
+        publish(key, e);
+
+        rs.send(e->response);
+    }
+
+private:
+    struct entry
+    {
+        bool ready = false;
+        bool stored = false;
+        std::chrono::steady_clock::time_point expires;
+        stored_response response;
+        std::vector<std::function<void()>> waiters;
+    };
+
+    // Collects the handler's output instead of sending it.
+    class capture_streambuf : public socket_streambuf_base
+    {
+    public:
+        explicit capture_streambuf(stored_response& r) : response_(r) {}
+
+        void write_header(int code, boost::string_view contentType, std::streamsize, boost::string_view fields) override
+        {
+            response_.code = code;
+            response_.contentType = contentType.to_string();
+            response_.fields = fields.to_string();
+        }
+
+    protected:
+        std::size_t read_some(char*, std::size_t, boost::system::error_code& ec) override
+        {
+            ec = boost::asio::error::eof;
+            return 0;
+        }
+
+        void write(const char* data, std::size_t size, boost::system::error_code&) override
+        {
+            response_.body.append(data, size);
+        }
+
+    private:
+        stored_response& response_;
+    };
+
+    // Request headers that select between representations; a response may only Vary by these.
+    static bool is_key_header(boost::string_view name)
+    {
+        return boost::algorithm::iequals(name, "accept") || boost::algorithm::iequals(name, "accept-encoding") || boost::algorithm::iequals(name, "accept-language");
+    }
+
+    // Path, Accept* headers and parameters, each prefixed with its length; parameters are already sorted by name.
+    static std::string make_key(const request& rq)
+    {
+        std::string key;
+        auto append = [&key](boost::string_view s) {
+            std::uint32_t n = static_cast<std::uint32_t>(s.size());
+            key.append(reinterpret_cast<const char*>(&n), sizeof(n)).append(s.data(), s.size());
+        };
+        append(rq.path_view());
+        append(rq.header_view("accept"));
+        append(rq.header_view("accept-encoding"));
+        append(rq.header_view("accept-language"));
+        for (const auto& parameter : rq.parameters()) {
+            append(parameter.first);
+            append(parameter.second);
+        }
+        return key;
+    }
+
+    void run_handler(request& rq, entry& e)
+    {
+        // on the heap, as its buffers would take half of a small coroutine stack
+        std::unique_ptr<capture_streambuf> sb(new capture_streambuf(e.response));
+        response rs(sb.get());
+        handler_(rq, rs);
+        rs.close();
+
+        stored_response& r = e.response;
+        std::string length = std::to_string(r.body.size());
+        r.header.reserve(r.contentType.size() + length.size() + r.fields.size() + 36);
+        r.header.append("Content-Type: ").append(r.contentType).append("\r\n");
+        r.header.append("Content-Length: ").append(length).append("\r\n");
+        r.header.append(r.fields).append("\r\n");
+        e.stored = storable(r);
+    }
+
+    // Server errors, cookies, responses the handler marked private and those varying by headers outside the key are not shared.
+    static bool storable(const stored_response& r)
+    {
+        if (r.code >= 500) return false;
+
+        boost::string_view fields(r.fields);
+        while (!fields.empty()) {
+            boost::string_view line = fields.substr(0, fields.find("\r\n"));
+            fields.remove_prefix(line.size() + 2);
+
+            boost::string_view name = line.substr(0, line.find(':'));
+            if (boost::algorithm::iequals(name, "set-cookie")) return false;
+            if (boost::algorithm::iequals(name, "cache-control")
+                && (boost::algorithm::ifind_first(line, "no-store") || boost::algorithm::ifind_first(line, "private"))) return false;
+            if (boost::algorithm::iequals(name, "vary")) {
+                boost::string_view values = line.substr(std::min(name.size() + 1, line.size()));
+                while (!values.empty()) {
+                    boost::string_view value = values.substr(0, values.find(','));
+                    values.remove_prefix(std::min(value.size() + 1, values.size()));
+                    if (!is_key_header(utils::trim(value))) return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Makes the result visible to later requests and wakes the ones waiting for it.
+    void publish(const std::string& key, const std::shared_ptr<entry>& e)
+    {
+        e->ready = true;
+        e->expires = std::chrono::steady_clock::now() + ttl_;
+
+        auto it = entries_.find(key);
+        if (it != entries_.end() && it->second == e) {
+            if (e->stored) {
+                order_.emplace_back(key, e);
+                trim(std::chrono::steady_clock::now());
+            } else {
+                entries_.erase(it);
+            }
+        }
+
+        std::vector<std::function<void()>> waiters;
+        waiters.swap(e->waiters);
+        for (auto& w : waiters) w();
+    }
+
+    // Suspends the calling coroutine until publish() resumes it through its strand.
+    static void wait(entry& e, boost::asio::yield_context yield)
+    {
+        boost::asio::async_completion<boost::asio::yield_context, void()> init(yield);
+        auto resume = init.completion_handler;
+        e.waiters.push_back([resume]() mutable { boost::asio::post(std::move(resume)); });
+        init.result.get();
+    }
+
+    // Drops expired entries, and the oldest ones while more than maxEntries_ are stored.
+    // All entries live for the same TTL, so order_ is also the order of expiry.
+    void trim(std::chrono::steady_clock::time_point now)
+    {
+        while (!order_.empty()) {
+            auto it = entries_.find(order_.front().first);
+            bool current = it != entries_.end() && it->second == order_.front().second.lock();  // not replaced since
+            if (current && it->second->expires > now && order_.size() <= maxEntries_) break;
+
+            if (current) entries_.erase(it);
+            order_.pop_front();
+        }
+    }
+
+    handler handler_;
+    std::chrono::steady_clock::duration ttl_;
+    std::size_t maxEntries_;
+    std::map<std::string, std::shared_ptr<entry>> entries_;     // stored ones and those whose handler is running
+    std::deque<std::pair<std::string, std::weak_ptr<entry>>> order_;    // stored entries, oldest first
+};
+
+// Boyer-Moore-Horspool search for a fixed pattern, such as a multipart delimiter.
+class horspool_searcher
+{
+public:
+    explicit horspool_searcher(const std::string& pattern)
+        : pattern_(pattern)
+    {
+        skip_.fill(pattern_.size());
+        for (std::size_t i = 0; i + 1 < pattern_.size(); i++) {
+            skip_[static_cast<unsigned char>(pattern_[i])] = pattern_.size() - 1 - i;
+        }
+    }
+
+    // Returns the offset of the first match in [first, last), or std::string::npos.
+    std::size_t search(const char* first, const char* last) const
+    {
+        const std::size_t n = pattern_.size();
+        if (n == 0 || static_cast<std::size_t>(last - first) < n) return std::string::npos;
+
+        for (const char* p = first; p <= last - n; p += skip_[static_cast<unsigned char>(p[n - 1])]) {
+            if (p[n - 1] == pattern_[n - 1] && std::memcmp(p, pattern_.data(), n - 1) == 0) return p - first;
+        }
+        return std::string::npos;
+    }
+
+    std::size_t size() const { return pattern_.size(); }
+
+private:
+    std::string pattern_;
+    std::array<std::size_t, 256> skip_;
+};
+
+}   // namespace boost_asio_http::detail
+
+// Reads a multipart/form-data body part by part as it arrives, in a fixed-size buffer.
+//
+//    multipart_reader parts(rq);
+//    while (parts.next()) {
+//        if (!parts.filename().empty()) save(parts.filename(), parts.stream());
+//    }
+class multipart_reader : private std::streambuf
+{
+public:
+    multipart_reader(const multipart_reader&) = delete;
+    multipart_reader& operator=(const multipart_reader&) = delete;
+
+    explicit multipart_reader(request& rq)
+        : multipart_reader(rq.stream(), rq.content_type()) {}
+
+    multipart_reader(std::istream& body, const std::string& contentType)
+        : source_(body.rdbuf()), searcher_("\r\n--" + boundary(contentType)), buffer_(buffer_size + searcher_.size()),
+          pos_(0), end_(0), partEnded_(false), finished_(false), is_(this)
+    {
+        // the first delimiter has no preceding CRLF; pretend it had one, so that the preamble is just an ignored part
+        end_ = 2;
+        buffer_[0] = '\r';
+        buffer_[1] = '\n';
+        finished_ = searcher_.size() == 4 || !source_;
+    }
+
+    // Skips the rest of the current part and moves to the next one; false after the last part or on malformed input.
+    bool next()
+    {
+        if (finished_) return false;
+
+        setg(nullptr, nullptr, nullptr);
+        while (underflow() != traits_type::eof()) setg(nullptr, nullptr, nullptr);
+        if (finished_) return false;
+
+        pos_ += searcher_.size();
+        if (!fill(2)) return finish();
+        if (buffer_[pos_] == '-' && buffer_[pos_ + 1] == '-') return finish();    // close delimiter; the epilogue is ignored
+
+        while (fill(1) && (buffer_[pos_] == ' ' || buffer_[pos_] == '\t')) pos_++;
+        if (!fill(2) || buffer_[pos_] != '\r' || buffer_[pos_ + 1] != '\n') return finish();
+        pos_ += 2;
+
+        headers_.clear();
+        for (;;) {
+            std::size_t eol;
+            while ((eol = find_crlf()) == std::string::npos) {
+                if (!fill(end_ - pos_ + 1)) return finish();    // a header line longer than the buffer is rejected, too
+            }
+
+            std::string line(&buffer_[pos_], eol);
+            pos_ += eol + 2;
+            if (line.empty()) break;
+
+            auto colon = line.find(':');
+            if (colon == std::string::npos || headers_.size() >= max_headers) return finish();
+            headers_.emplace_back(boost::algorithm::to_lower_copy(boost::algorithm::trim_copy(line.substr(0, colon))), boost::algorithm::trim_copy(line.substr(colon + 1)));
+        }
+
+        partEnded_ = false;
+        is_.clear();
+        return true;
+    }
+
+    // 'name' is case-insensitive; returns an empty string for a missing header.
+    std::string header(const std::string& name) const
+    {
+        for (auto& h : headers_) {
+            if (boost::algorithm::iequals(h.first, name)) return h.second;
+        }
+        return "";
+    }
+
+    std::string name() const { return disposition_parameter("name"); }
+    std::string filename() const { return disposition_parameter("filename"); }
+
+    std::string content_type() const
+    {
+        std::string type = header("content-type");
+        return type.empty() ? "text/plain" : type;
+    }
+
+    // Body of the current part; ends at the next delimiter.
+    std::istream& stream() { return is_; }
+
+private:
+    static constexpr std::size_t buffer_size = 16 * 1024;
+    static constexpr std::size_t max_headers = 16;
+
+    static std::string boundary(const std::string& contentType)
+    {
+        if (!detail::utils::is_media_type(contentType, "multipart/form-data")) return "";
+
+        std::vector<std::string> params;
+        boost::algorithm::split(params, contentType, boost::is_any_of(";"));
+        for (auto& p : params) {
+            auto pos = p.find('=');
+            if (pos != std::string::npos && boost::algorithm::iequals(boost::algorithm::trim_copy(p.substr(0, pos)), "boundary")) {
+                return boost::algorithm::trim_copy_if(p.substr(pos + 1), boost::is_any_of(" \""));
+            }
+        }
+        return "";
+    }
+
+    std::string disposition_parameter(const std::string& name) const
+    {
+        std::vector<std::string> params;
+        std::string disposition = header("content-disposition");
+        boost::algorithm::split(params, disposition, boost::is_any_of(";"));
+        for (std::size_t i = 1; i < params.size(); i++) {
+            auto pos = params[i].find('=');
+            if (pos != std::string::npos && boost::algorithm::iequals(boost::algorithm::trim_copy(params[i].substr(0, pos)), name)) {
+                return boost::algorithm::trim_copy_if(params[i].substr(pos + 1), boost::is_any_of(" \""));
+            }
+        }
+        return "";
+    }
+
+    bool finish()
+    {
+        finished_ = true;
+        return false;
+    }
+
+    std::size_t find_crlf() const
+    {
+        for (std::size_t i = pos_; i + 1 < end_; i++) {
+            if (buffer_[i] == '\r' && buffer_[i + 1] == '\n') return i - pos_;
+        }
+        return std::string::npos;
+    }
+
+    // Makes at least 'n' unread bytes available, reading only what the source already has when possible.
+    bool fill(std::size_t n)
+    {
+        while (end_ - pos_ < n) {
+            if (pos_ > 0) {
+                std::memmove(&buffer_[0], &buffer_[pos_], end_ - pos_);
+                end_ -= pos_;
+                pos_ = 0;
+            }
+            if (n > buffer_.size() || traits_type::eq_int_type(source_->sgetc(), traits_type::eof())) return false;
+
+            std::streamsize available = std::max<std::streamsize>(source_->in_avail(), 1);
+            end_ += static_cast<std::size_t>(source_->sgetn(&buffer_[end_], std::min<std::streamsize>(available, buffer_.size() - end_)));
+        }
+        return true;
+    }
+
+    // Hands out data up to the next delimiter; a tail that may start a delimiter is kept back until more arrives.
+    int underflow() override
+    {
+        if (partEnded_) return traits_type::eof();
+
+        for (;;) {
+            std::size_t found = searcher_.search(&buffer_[pos_], &buffer_[0] + end_);
+            std::size_t available;
+            if (found != std::string::npos) {
+                available = found;
+                partEnded_ = true;
+            } else {
+                available = end_ - pos_ >= searcher_.size() ? end_ - pos_ - (searcher_.size() - 1) : 0;
+            }
+
+            if (available > 0) {
+                setg(&buffer_[pos_], &buffer_[pos_], &buffer_[pos_] + available);
+                pos_ += available;
+                return traits_type::to_int_type(*gptr());
+            }
+            if (partEnded_) return traits_type::eof();
+
+            if (!fill(end_ - pos_ + 1)) {    // the body ended without a close delimiter
+                partEnded_ = true;
+                finished_ = true;
+                return traits_type::eof();
+            }
+        }
+    }
+
+    std::streambuf* source_;
+    detail::horspool_searcher searcher_;
+    std::vector<char> buffer_;
+    std::size_t pos_, end_;
+    bool partEnded_, finished_;
+    detail::header_list headers_;
+    std::istream is_;
+};
+
+namespace detail {
+
+class coroutine_event
+{
+public:
+    template <class Executor>
+    explicit coroutine_event(const Executor& executor) : timer_(executor, boost::asio::steady_timer::time_point::max()) {}
+
+    // Waiters re-check their condition in a loop; notify() wakes all of them.
+    void wait(boost::asio::yield_context yield)
+    {
+        boost::system::error_code ec;
+        timer_.async_wait(yield[ec]);
+    }
+
+    void notify() { timer_.cancel(); }
+
+private:
+    boost::asio::steady_timer timer_;
+};
+
+template <class Stream>
+class http2_session
+{
+public:
+    http2_session(const http2_session&) = delete;
+    http2_session& operator=(const http2_session&) = delete;
+
+    using strand_type = boost::asio::strand<boost::asio::io_context::executor_type>;
+
+    explicit http2_session(Stream& stream, socket_streambuf_base& sb, strand_type strand, handler dispatch)
+        : stream_(stream), sb_(sb), strand_(strand), dispatch_(dispatch), lastStreamId_(0), activeStreams_(0),
+          connectionSendWindow_(default_window_size), connectionRecvWindow_(connection_window_size), connectionUnacknowledged_(0),
+          peerInitialWindow_(default_window_size), peerMaxFrameSize_(default_max_frame_size),
+          headerStream_(0), headerEndStream_(false), continuation_(false),
+          closed_(false), goingAway_(false), finished_(false), writerRunning_(false), writerEvent_(strand), drainEvent_(strand) {}
+
+    static bool is_prior_knowledge(const request& rq) { return rq.method_view() == "PRI" && rq.protocol_view() == "HTTP/2.0"; }
+
+    static bool is_upgrade(const request& rq)
+    {
+        return boost::algorithm::iequals(rq.header_view("upgrade"), "h2c") && !rq.header_view("http2-settings").empty()
+            && rq.content_length() == 0 && rq.header_view("transfer-encoding").empty();
+    }
+
+    // Serves the connection until the peer closes it; 'rq' is the HTTP/1.1 request that selected HTTP/2.
+    void run(request& rq, boost::asio::yield_context yield)
+    {
+        bool upgrade = is_upgrade(rq);
+        if (upgrade) {
+            std::ostream os(&sb_);
+            os << "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+            os.flush();
+            if (!os) return;
+
+            std::string settings = utils::decode_base64(rq.header("http2-settings"));
+            if (apply_settings(reinterpret_cast<const unsigned char*>(settings.data()), settings.size()) != no_error) return;
+        }
+
+        start_writer();
+
+        // server connection preface
+        unsigned char settings[] = { 0, settings_max_concurrent_streams, 0, 0, 0, max_concurrent_streams,
+                                     0, settings_max_header_list_size, 0, 0, max_header_list_size >> 8, max_header_list_size & 0xff };
+        queue_frame(frame_settings, 0, 0, settings, sizeof(settings));
+        send_window_update(0, connection_window_size - default_window_size);
+
+        const std::string preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+        const std::string rest = upgrade ? preface : preface.substr(preface.find("SM"));
+        std::string received(rest.size(), '\0');
+        if (read_exact(&received[0], received.size()) && received == rest) {
+            if (upgrade) {
+                header_list headers = { {":method", rq.method_.to_string()}, {":path", rq.uri_.to_string()}, {":scheme", "http"} };
+                for (auto& h : rq.headers_) headers.emplace_back(h.first.to_string(), h.second.to_string());
+                lastStreamId_ = 1;
+                open_stream(1, std::move(headers), true);
+            }
+            read_frames();
+        }
+
+        // the peer is gone or broke the protocol: abort the streams, then let the writer drain
+        closed_ = true;
+        for (auto& s : streams_) s.second->event.notify();
+        while (activeStreams_ > 0) drainEvent_.wait(yield);
+
+        finished_ = true;
+        writerEvent_.notify();
+        while (writerRunning_) drainEvent_.wait(yield);
+    }
+
+private:
+    enum frame_type { frame_data = 0, frame_headers = 1, frame_priority = 2, frame_rst_stream = 3, frame_settings = 4, frame_push_promise = 5, frame_ping = 6, frame_goaway = 7, frame_window_update = 8, frame_continuation = 9 };
+    enum frame_flag { flag_end_stream = 0x1, flag_ack = 0x1, flag_end_headers = 0x4, flag_padded = 0x8, flag_priority = 0x20 };
+    enum setting { settings_header_table_size = 1, settings_enable_push = 2, settings_max_concurrent_streams = 3, settings_initial_window_size = 4, settings_max_frame_size = 5, settings_max_header_list_size = 6 };
+    enum error { no_error = 0, protocol_error = 1, internal_error = 2, flow_control_error = 3, stream_closed = 5, frame_size_error = 6, refused_stream = 7, compression_error = 9, enhance_your_calm = 11 };
+
+    static constexpr std::int64_t default_window_size = 65535;
+    static constexpr std::int64_t max_window_size = 0x7fffffff;
+    static constexpr std::int64_t connection_window_size = 1 << 20;
+    static constexpr std::size_t default_max_frame_size = 16384;
+    static constexpr std::size_t max_concurrent_streams = 100;
+    static constexpr std::size_t max_pending_size = 256 * 1024;
+    static constexpr std::size_t max_header_list_size = 16 * 1024;     // also bounds the encoded header block
+
+    class stream_buffer;
+
+    struct stream_state
+    {
+        stream_state(std::uint32_t id, header_list headers, bool remoteClosed, std::int64_t sendWindow, strand_type strand)
+            : id(id), headers(std::move(headers)), receivedOffset(0), sendWindow(sendWindow), recvWindow(default_window_size), unacknowledged(0),
+              remoteClosed(remoteClosed), endSent(false), reset(false), event(strand) {}
+
+        std::uint32_t id;
+        header_list headers;
+        std::string received;               // DATA not yet read by the handler
+        std::size_t receivedOffset;
+        std::int64_t sendWindow;
+        std::int64_t recvWindow;
+        std::int64_t unacknowledged;        // consumed, but not yet returned by WINDOW_UPDATE
+        bool remoteClosed, endSent, reset;
+        coroutine_event event;
+        std::unique_ptr<stream_buffer> buffer;
+    };
+    using stream_ptr = std::shared_ptr<stream_state>;
+
+    // Request body and response entity of one stream, seen by the handler as a plain stream.
+    class stream_buffer : public socket_streambuf_base
+    {
+    public:
+        stream_buffer(http2_session& session, stream_state& stream, boost::asio::yield_context yield)
+            : session_(session), stream_(stream), yield_(yield) {}
+
+        void write_header(int code, boost::string_view contentType, std::streamsize contentLength, boost::string_view fields) override
+        {
+            session_.send_header(stream_, code, contentType, contentLength, fields);
+        }
+
+        void write_response(const stored_response& r) override
+        {
+            session_.send_header(stream_, r.code, r.contentType, static_cast<std::streamsize>(r.body.size()), r.fields);
+            if (sync() == 0) {
+                boost::system::error_code ec;
+                session_.write_data(stream_, r.body.data(), r.body.size(), yield_, ec);
+            }
+        }
+
+        boost::asio::yield_context* coroutine() override { return &yield_; }
+
+    protected:
+        std::size_t read_some(char* data, std::size_t size, boost::system::error_code& ec) override
+        {
+            return session_.read_data(stream_, data, size, yield_, ec);
+        }
+
+        void write(const char* data, std::size_t size, boost::system::error_code& ec) override
+        {
+            session_.write_data(stream_, data, size, yield_, ec);
+        }
+
+    private:
+        http2_session& session_;
+        stream_state& stream_;
+        boost::asio::yield_context yield_;
+    };
+
+    bool read_exact(char* data, std::size_t size)
+    {
+        return sb_.sgetn(data, static_cast<std::streamsize>(size)) == static_cast<std::streamsize>(size);
+    }
+
+    static std::uint32_t read_uint32(const unsigned char* p) { return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | p[3]; }
+
+    void read_frames()
+    {
+        std::array<unsigned char, 9> header;
+        std::vector<unsigned char> payload;
+
+        while (read_exact(reinterpret_cast<char*>(header.data()), header.size())) {
+            std::size_t length = (std::size_t(header[0]) << 16) | (std::size_t(header[1]) << 8) | header[2];
+            unsigned char type = header[3];
+            unsigned char flags = header[4];
+            std::uint32_t id = read_uint32(&header[5]) & 0x7fffffff;
+
+            if (length > default_max_frame_size) {
+                send_goaway(frame_size_error);
+                return;
+            }
+            payload.resize(length);
+            if (length > 0 && !read_exact(reinterpret_cast<char*>(payload.data()), length)) return;
+
+            error e = no_error;
+            if (continuation_ && type != frame_continuation) {     // a header block may not be interleaved
+                e = protocol_error;
+            } else {
+                switch (type) {
+                case frame_data: e = on_data(flags, id, payload); break;
+                case frame_headers: e = on_headers(flags, id, payload); break;
+                case frame_continuation: e = on_continuation(flags, id, payload); break;
+                case frame_rst_stream: e = on_rst_stream(id, payload); break;
+                case frame_settings: e = on_settings(flags, id, payload); break;
+                case frame_ping: e = on_ping(flags, id, payload); break;
+                case frame_goaway: goingAway_ = true; break;
+                case frame_window_update: e = on_window_update(id, payload); break;
+                case frame_push_promise: e = protocol_error; break;
+                default: break;     // PRIORITY and unknown frames are ignored
+                }
+            }
+
+            if (e != no_error) {
+                send_goaway(e);
+                return;
+            }
+        }
+    }
+
+    // Strips padding (and priority fields) and returns false when they don't fit in the frame.
+    static bool strip_padding(unsigned char flags, const std::vector<unsigned char>& payload, std::size_t prefix, std::size_t& begin, std::size_t& end)
+    {
+        begin = 0;
+        end = payload.size();
+        if (flags & flag_padded) {
+            if (payload.empty() || payload[0] >= payload.size()) return false;
+            begin = 1;
+            end -= payload[0];
+        }
+        begin += prefix;
+        return begin <= end;
+    }
+
+    error on_data(unsigned char flags, std::uint32_t id, const std::vector<unsigned char>& payload)
+    {
+        std::size_t begin, end;
+        if (id == 0 || !strip_padding(flags, payload, 0, begin, end)) return protocol_error;
+
+        std::int64_t length = static_cast<std::int64_t>(payload.size());
+        if (length > connectionRecvWindow_) return flow_control_error;
+        connectionRecvWindow_ -= length;
+
+        auto it = streams_.find(id);
+        if (it == streams_.end() || it->second->remoteClosed || it->second->reset || length > it->second->recvWindow) {
+            if (it == streams_.end() && id > lastStreamId_) return protocol_error;
+            if (it != streams_.end()) {
+                reset_stream(*it->second, length > it->second->recvWindow ? flow_control_error : stream_closed);
+            }
+            acknowledge_connection(length);
+            return no_error;
+        }
+
+        stream_state& s = *it->second;
+        s.recvWindow -= length;
+        s.received.append(reinterpret_cast<const char*>(payload.data()) + begin, end - begin);
+        if (flags & flag_end_stream) s.remoteClosed = true;
+
+        // padding is never read by the handler, so its window is returned at once
+        s.unacknowledged += length - static_cast<std::int64_t>(end - begin);
+        acknowledge_connection(length - static_cast<std::int64_t>(end - begin));
+
+        s.event.notify();
+        return no_error;
+    }
+
+    error on_headers(unsigned char flags, std::uint32_t id, const std::vector<unsigned char>& payload)
+    {
+        std::size_t begin, end;
+        if (id == 0 || (id % 2) == 0 || !strip_padding(flags, payload, (flags & flag_priority) ? 5 : 0, begin, end)) return protocol_error;
+
+        headerStream_ = id;
+        headerEndStream_ = (flags & flag_end_stream) != 0;
+        if (end - begin > max_header_list_size) return enhance_your_calm;
+        headerBlock_.assign(payload.begin() + begin, payload.begin() + end);
+
+        if (!(flags & flag_end_headers)) {
+            continuation_ = true;
+            return no_error;
+        }
+        return on_header_block();
+    }
+
+    error on_continuation(unsigned char flags, std::uint32_t id, const std::vector<unsigned char>& payload)
+    {
+        // RFC 7540 6.10: CONTINUATION only follows a block left open on the same stream
+        if (!continuation_ || id != headerStream_) return protocol_error;
+
+        // an unbounded block can't be decoded partially, so the connection is given up
+        if (headerBlock_.size() + payload.size() > max_header_list_size) return enhance_your_calm;
+        headerBlock_.insert(headerBlock_.end(), payload.begin(), payload.end());
+        if (!(flags & flag_end_headers)) return no_error;
+
+        continuation_ = false;
+        return on_header_block();
+    }
+
+    error on_header_block()
+    {
+        header_list headers;
+        bool overflow = false;
+        if (!decoder_.decode(headerBlock_.data(), headerBlock_.size(), headers, max_header_list_size, overflow)) return compression_error;
+
+        auto it = streams_.find(headerStream_);
+        if (it != streams_.end()) {     // trailers
+            if (!headerEndStream_) return protocol_error;
+            if (overflow) {
+                reset_stream(*it->second, enhance_your_calm);
+                return no_error;
+            }
+            it->second->remoteClosed = true;
+            it->second->event.notify();
+            return no_error;
+        }
+        if (headerStream_ <= lastStreamId_) return stream_closed;  // closed, or skipped and so implicitly closed
+        lastStreamId_ = headerStream_;
+
+        if (overflow) {
+            send_rst_stream(headerStream_, enhance_your_calm);
+            return no_error;
+        }
+
+        if (goingAway_) return no_error;
+        if (streams_.size() >= max_concurrent_streams) {
+            send_rst_stream(headerStream_, refused_stream);
+            return no_error;
+        }
+
+        open_stream(headerStream_, std::move(headers), headerEndStream_);
+        return no_error;
+    }
+
+    error on_rst_stream(std::uint32_t id, const std::vector<unsigned char>& payload)
+    {
+        if (id == 0) return protocol_error;
+        if (payload.size() != 4) return frame_size_error;
+
+        auto it = streams_.find(id);
+        if (it != streams_.end()) {
+            it->second->reset = true;
+            it->second->event.notify();
+        }
+        return no_error;
+    }
+
+    error on_settings(unsigned char flags, std::uint32_t id, const std::vector<unsigned char>& payload)
+    {
+        if (id != 0) return protocol_error;
+        if (flags & flag_ack) return payload.empty() ? no_error : frame_size_error;
+
+        error e = apply_settings(payload.data(), payload.size());
+        if (e == no_error) queue_frame(frame_settings, flag_ack, 0, nullptr, 0);
+        return e;
+    }
+
+    error apply_settings(const unsigned char* data, std::size_t size)
+    {
+        if (size % 6 != 0) return frame_size_error;
+
+        for (std::size_t i = 0; i < size; i += 6) {
+            unsigned int key = (data[i] << 8) | data[i + 1];
+            std::uint32_t value = read_uint32(data + i + 2);
+
+            switch (key) {
+            case settings_header_table_size:
+                encoder_.set_max_table_size(value);
+                break;
+            case settings_enable_push:
+                if (value > 1) return protocol_error;
+                break;
+            case settings_initial_window_size:
+                if (value > max_window_size) return flow_control_error;
+                for (auto& s : streams_) {
+                    s.second->sendWindow += static_cast<std::int64_t>(value) - peerInitialWindow_;
+                    if (s.second->sendWindow > max_window_size) return flow_control_error;     // RFC 7540 6.9.2
+                    s.second->event.notify();
+                }
+                peerInitialWindow_ = value;
+                break;
+            case settings_max_frame_size:
+                if (value < default_max_frame_size || value > 0xffffff) return protocol_error;
+                peerMaxFrameSize_ = value;
+                break;
+            default:
+                break;
+            }
+        }
+        return no_error;
+    }
+
+    error on_ping(unsigned char flags, std::uint32_t id, const std::vector<unsigned char>& payload)
+    {
+        if (id != 0) return protocol_error;
+        if (payload.size() != 8) return frame_size_error;
+
+        if (!(flags & flag_ack)) queue_frame(frame_ping, flag_ack, 0, payload.data(), payload.size());
+        return no_error;
+    }
+
+    error on_window_update(std::uint32_t id, const std::vector<unsigned char>& payload)
+    {
+        if (payload.size() != 4) return frame_size_error;
+
+        std::int64_t increment = read_uint32(payload.data()) & 0x7fffffff;
+        if (id == 0) {
+            if (increment == 0) return protocol_error;
+            connectionSendWindow_ += increment;
+            if (connectionSendWindow_ > max_window_size) return flow_control_error;
+            for (auto& s : streams_) s.second->event.notify();
+            return no_error;
+        }
+
+        auto it = streams_.find(id);
+        if (it == streams_.end()) return no_error;
+
+        stream_state& s = *it->second;
+        if (increment == 0 || s.sendWindow + increment > max_window_size) {
+            reset_stream(s, increment == 0 ? protocol_error : flow_control_error);
+        } else {
+            s.sendWindow += increment;
+        }
+        s.event.notify();
+        return no_error;
+    }
+
+    void open_stream(std::uint32_t id, header_list headers, bool remoteClosed)
+    {
+        auto s = std::make_shared<stream_state>(id, std::move(headers), remoteClosed, peerInitialWindow_, strand_);
+        streams_[id] = s;
+        activeStreams_++;
+
+        // each stream runs its handler in its own coroutine on the connection's strand
+        boost::asio::spawn(strand_, [this, s](boost::asio::yield_context yield) {
+            s->buffer.reset(new stream_buffer(*this, *s, yield));
+            std::unique_ptr<monotonic_arena> arena = acquire_arena();
+            try {
+                request rq(s->buffer.get(), s->headers, *arena);
+                response rs(s->buffer.get());
+                if (rq.rejectCode_ != 0) {
+                    rs.simple_response(static_cast<response::code>(rq.rejectCode_));
+                } else {
+                    dispatch_(rq, rs);
+                }
+                rs.close();
+
+                if (!s->reset && !closed_) {
+                    queue_frame(frame_data, flag_end_stream, s->id, nullptr, 0);
+                    s->endSent = true;
+                }
+            } catch (...) {
+            }
+            arena->reset();
+            arenas_.push_back(std::move(arena));
+            close_stream(*s);
+        });
+    }
+
+    // Arenas are reused by later streams of the connection.
+    std::unique_ptr<monotonic_arena> acquire_arena()
+    {
+        if (arenas_.empty()) return std::unique_ptr<monotonic_arena>(new monotonic_arena);
+
+        std::unique_ptr<monotonic_arena> arena = std::move(arenas_.back());
+        arenas_.pop_back();
+        return arena;
+    }
+
+    void close_stream(stream_state& s)
+    {
+        if (!s.reset && !closed_) {
+            if (!s.endSent) {
+                reset_stream(s, internal_error);
+            } else if (!s.remoteClosed) {
+                reset_stream(s, no_error);  // the rest of the request body isn't needed
+            }
+        }
+        acknowledge_connection(static_cast<std::int64_t>(s.received.size() - s.receivedOffset));
+
+        streams_.erase(s.id);
+        activeStreams_--;
+        drainEvent_.notify();
+    }
+
+    std::size_t read_data(stream_state& s, char* data, std::size_t size, boost::asio::yield_context yield, boost::system::error_code& ec)
+    {
+        while (s.receivedOffset == s.received.size() && !s.remoteClosed && !s.reset && !closed_) s.event.wait(yield);
+
+        if (s.reset || closed_) {
+            ec = boost::asio::error::connection_aborted;
+            return 0;
+        }
+        if (s.receivedOffset == s.received.size()) {
+            ec = boost::asio::error::eof;
+            return 0;
+        }
+
+        std::size_t n = std::min(size, s.received.size() - s.receivedOffset);
+        std::memcpy(data, s.received.data() + s.receivedOffset, n);
+        s.receivedOffset += n;
+        if (s.receivedOffset == s.received.size()) {
+            s.received.clear();
+            s.receivedOffset = 0;
+        }
+
+        // window updates are batched to one per half window
+        s.unacknowledged += n;
+        if (!s.remoteClosed && s.unacknowledged >= default_window_size / 2) {
+            send_window_update(s.id, s.unacknowledged);
+            s.recvWindow += s.unacknowledged;
+            s.unacknowledged = 0;
+        }
+        acknowledge_connection(static_cast<std::int64_t>(n));
+
+        return n;
+    }
+
+    void write_data(stream_state& s, const char* data, std::size_t size, boost::asio::yield_context yield, boost::system::error_code& ec)
+    {
+        while (size > 0) {
+            while (!s.reset && !closed_ && (s.sendWindow <= 0 || connectionSendWindow_ <= 0 || pending_.size() >= max_pending_size)) s.event.wait(yield);
+
+            if (s.reset || closed_) {
+                ec = boost::asio::error::connection_aborted;
+                return;
+            }
+
+            std::size_t n = std::min<std::size_t>({ size, peerMaxFrameSize_, static_cast<std::size_t>(s.sendWindow), static_cast<std::size_t>(connectionSendWindow_) });
+            queue_frame(frame_data, 0, s.id, data, n);
+            s.sendWindow -= n;
+            connectionSendWindow_ -= n;
+            data += n;
+            size -= n;
+        }
+    }
+
+    void send_header(stream_state& s, int code, boost::string_view contentType, std::streamsize contentLength, boost::string_view fields)
+    {
+        if (s.reset || closed_) return;
+
+        boost::string_view line = status_line(code);
+        header_list headers = {
+            {":status", line.empty() ? std::to_string(code) : line.substr(9, 3).to_string()},
+            {"date", date_header().substr(6, 29).to_string()},
+            {"content-type", contentType.to_string()}
+        };
+        if (contentLength != uninitialized_content_length) headers.emplace_back("content-length", std::to_string(contentLength));
+
+        // HTTP/2 field names are lowercase, and connection-specific fields are not allowed
+        while (!fields.empty()) {
+            line = fields.substr(0, fields.find("\r\n"));
+            fields.remove_prefix(line.size() + 2);
+
+            std::string name = line.substr(0, line.find(':')).to_string();
+            boost::algorithm::to_lower(name);
+            if (name == "connection" || name == "keep-alive" || name == "proxy-connection" || name == "transfer-encoding" || name == "upgrade") continue;
+            headers.emplace_back(std::move(name), utils::trim(line.substr(line.find(':') + 1)).to_string());
+        }
+
+        std::string block;
+        encoder_.encode(headers, block);
+
+        // the block is encoded against the shared table, so its frames are queued without interleaving
+        std::size_t offset = 0;
+        do {
+            std::size_t n = std::min(block.size() - offset, peerMaxFrameSize_);
+            bool last = offset + n == block.size();
+            queue_frame(offset == 0 ? frame_headers : frame_continuation, last ? flag_end_headers : 0, s.id, block.data() + offset, n);
+            offset += n;
+        } while (offset < block.size());
+    }
+
+    void reset_stream(stream_state& s, error e)
+    {
+        send_rst_stream(s.id, e);
+        s.reset = true;
+        s.event.notify();
+    }
+
+    void send_rst_stream(std::uint32_t id, error e)
+    {
+        unsigned char payload[4] = { 0, 0, 0, static_cast<unsigned char>(e) };
+        queue_frame(frame_rst_stream, 0, id, payload, sizeof(payload));
+    }
+
+    void send_window_update(std::uint32_t id, std::int64_t increment)
+    {
+        unsigned char payload[4];
+        for (int i = 0; i < 4; i++) payload[i] = static_cast<unsigned char>(increment >> (24 - 8 * i));
+        queue_frame(frame_window_update, 0, id, payload, sizeof(payload));
+    }
+
+    void send_goaway(error e)
+    {
+        unsigned char payload[8];
+        for (int i = 0; i < 4; i++) payload[i] = static_cast<unsigned char>(lastStreamId_ >> (24 - 8 * i));
+        payload[4] = payload[5] = payload[6] = 0;
+        payload[7] = static_cast<unsigned char>(e);
+        queue_frame(frame_goaway, 0, 0, payload, sizeof(payload));
+    }
+
+    void acknowledge_connection(std::int64_t n)
+    {
+        connectionUnacknowledged_ += n;
+        if (connectionUnacknowledged_ >= connection_window_size / 2) {
+            send_window_update(0, connectionUnacknowledged_);
+            connectionRecvWindow_ += connectionUnacknowledged_;
+            connectionUnacknowledged_ = 0;
+        }
+    }
+
+    template <class T>
+    void queue_frame(frame_type type, unsigned char flags, std::uint32_t id, const T* payload, std::size_t length)
+    {
+        const unsigned char header[9] = {
+            static_cast<unsigned char>(length >> 16), static_cast<unsigned char>(length >> 8), static_cast<unsigned char>(length),
+            static_cast<unsigned char>(type), flags,
+            static_cast<unsigned char>(id >> 24), static_cast<unsigned char>(id >> 16), static_cast<unsigned char>(id >> 8), static_cast<unsigned char>(id)
+        };
+        pending_.append(reinterpret_cast<const char*>(header), sizeof(header));
+        if (length > 0) pending_.append(reinterpret_cast<const char*>(payload), length);
+        writerEvent_.notify();
+    }
+
+    void queue_frame(frame_type type, unsigned char flags, std::uint32_t id, std::nullptr_t, std::size_t length)
+    {
+        queue_frame(type, flags, id, static_cast<const char*>(nullptr), length);
+    }
+
+    // Frames queued while a write is in flight go out together in the next write.
+    void start_writer()
+    {
+        writerRunning_ = true;
+        boost::asio::spawn(strand_, [this](boost::asio::yield_context yield) {
+            std::string writing;
+            for (;;) {
+                while (pending_.empty() && !finished_) writerEvent_.wait(yield);
+                if (pending_.empty()) break;
+
+                writing.swap(pending_);
+                boost::system::error_code ec;
+                boost::asio::async_write(stream_, boost::asio::buffer(writing), yield[ec]);
+                writing.clear();
+                if (ec) {
+                    closed_ = true;
+                    stream_.lowest_layer().close(ec);
+                    pending_.clear();
+                }
+
+                for (auto& s : streams_) s.second->event.notify();
+            }
+            writerRunning_ = false;
+            drainEvent_.notify();
+        });
+    }
+
+    Stream& stream_;
+    socket_streambuf_base& sb_;
+    strand_type strand_;
+    handler dispatch_;
+
+    hpack_decoder decoder_;
+    hpack_encoder encoder_;
+
+    std::map<std::uint32_t, stream_ptr> streams_;
+    std::vector<std::unique_ptr<monotonic_arena>> arenas_;
+    std::uint32_t lastStreamId_;
+    std::size_t activeStreams_;
+
+    std::int64_t connectionSendWindow_;
+    std::int64_t connectionRecvWindow_;
+    std::int64_t connectionUnacknowledged_;
+    std::int64_t peerInitialWindow_;
+    std::size_t peerMaxFrameSize_;
+
+    std::vector<unsigned char> headerBlock_;
+    std::uint32_t headerStream_;
+    bool headerEndStream_;
+    bool continuation_;
+
+    std::string pending_;
+    bool closed_, goingAway_, finished_, writerRunning_;
+    coroutine_event writerEvent_, drainEvent_;
+};
+
+#ifdef BOOST_ASIO_HTTP_USE_ZLIB
+// permessage-deflate (RFC 7692) state of one WebSocket connection.
+class permessage_deflate
+{
+public:
+    permessage_deflate(const permessage_deflate&) = delete;
+    permessage_deflate& operator=(const permessage_deflate&) = delete;
+
+    permessage_deflate(int serverMaxWindowBits, bool serverNoContextTakeover)
+        : serverNoContextTakeover_(serverNoContextTakeover)
+    {
+        std::memset(&deflate_, 0, sizeof(deflate_));
+        std::memset(&inflate_, 0, sizeof(inflate_));
+        deflateInit2(&deflate_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -serverMaxWindowBits, 8, Z_DEFAULT_STRATEGY);
+        inflateInit2(&inflate_, -15);
+    }
+
+    ~permessage_deflate()
+    {
+        deflateEnd(&deflate_);
+        inflateEnd(&inflate_);
+    }
+
+    // Picks the first acceptable offer of Sec-WebSocket-Extensions; returns the response value or an empty string.
+    static std::string negotiate(const std::string& offers, int& serverMaxWindowBits, bool& serverNoContextTakeover)
+    {
+        std::vector<std::string> list;
+        boost::algorithm::split(list, offers, boost::is_any_of(","));
+        for (auto& offer : list) {
+            std::vector<std::string> params;
+            boost::algorithm::split(params, offer, boost::is_any_of(";"));
+            if (boost::algorithm::trim_copy(params[0]) != "permessage-deflate") continue;
+
+            std::string accepted = "permessage-deflate";
+            bool acceptable = true;
+            serverMaxWindowBits = 15;
+            serverNoContextTakeover = false;
+            for (std::size_t i = 1; i < params.size() && acceptable; i++) {
+                auto pos = params[i].find('=');
+                std::string name = boost::algorithm::trim_copy(params[i].substr(0, pos));
+                std::string value = pos != std::string::npos ? boost::algorithm::trim_copy_if(params[i].substr(pos + 1), boost::is_any_of(" \"")) : "";
+
+                if (name == "server_no_context_takeover") {
+                    serverNoContextTakeover = true;
+                    accepted += "; server_no_context_takeover";
+                } else if (name == "server_max_window_bits") {
+                    serverMaxWindowBits = std::atoi(value.c_str());
+                    acceptable = serverMaxWindowBits >= 9 && serverMaxWindowBits <= 15;    // zlib has no 256-byte window
+                    accepted += "; server_max_window_bits=" + std::to_string(serverMaxWindowBits);
+                } else if (name != "client_no_context_takeover" && name != "client_max_window_bits") {
+                    acceptable = false;
+                }
+            }
+            if (acceptable) return accepted;
         }
+        return "";
+    }
 
-        return static_cast<unsigned char>(*gptr());
+    void compress(const char* data, std::size_t size, std::string& out)
+    {
+        out.clear();
+        deflate_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        deflate_.avail_in = static_cast<uInt>(size);
+        do {
+            std::size_t offset = out.size();
+            out.resize(offset + chunk_size);
+            deflate_.next_out = reinterpret_cast<Bytef*>(&out[offset]);
+            deflate_.avail_out = chunk_size;
+            deflate(&deflate_, Z_SYNC_FLUSH);
+            out.resize(out.size() - deflate_.avail_out);
+        } while (deflate_.avail_out == 0);
+
+        // the empty stored block of the flush is implied by the protocol
+        if (out.size() >= 4 && out.compare(out.size() - 4, 4, "\x00\x00\xff\xff", 4) == 0) out.resize(out.size() - 4);
+        if (serverNoContextTakeover_) deflateReset(&deflate_);
     }
 
-    int sync()
+    enum result { ok, corrupt, too_big };
+
+    // Replaces 'data' by its decompressed form unless it is corrupt or grows beyond 'maxSize'.
+    result decompress(std::string& data, std::size_t maxSize)
     {
-        if (pbase() != pptr()) {
-            boost::system::error_code ec;
-            boost::asio::async_write(socket_, boost::asio::buffer(pbase(), std::distance(pbase(), pptr())), yield_[ec]);
-            if (ec) return -1;
+        data.append("\x00\x00\xff\xff", 4);
+        inflate_.next_in = reinterpret_cast<Bytef*>(&data[0]);
+        inflate_.avail_in = static_cast<uInt>(data.size());
+
+        std::string out;
+        do {
+            std::size_t offset = out.size();
+            out.resize(offset + chunk_size);
+            inflate_.next_out = reinterpret_cast<Bytef*>(&out[offset]);
+            inflate_.avail_out = chunk_size;
+            int ret = inflate(&inflate_, Z_SYNC_FLUSH);
+            out.resize(out.size() - inflate_.avail_out);
+
+            if (ret == Z_STREAM_END) {
+                inflateReset(&inflate_);
+                break;
+            }
+            if (ret != Z_OK && ret != Z_BUF_ERROR) return corrupt;
+            if (out.size() > maxSize) return too_big;
+        } while (inflate_.avail_out == 0);
 
-            pbump(static_cast<int>(pbase() - pptr()));
-        }
-        return 0;
+        data.swap(out);
+        return ok;
     }
 
 private:
-    static constexpr std::streamsize bufferSize = 16 * 1024;
-    boost::asio::ip::tcp::socket socket_;
-    boost::asio::yield_context yield_;
-    std::array<char, bufferSize> inBuffer_, outBuffer_;
-    std::streamsize remained_;
+    static constexpr uInt chunk_size = 16 * 1024;
+
+    z_stream deflate_, inflate_;
+    bool serverNoContextTakeover_;
 };
+#endif
 
-class utils
+}   // namespace boost_asio_http::detail
+
+// Message-oriented stream of an upgraded connection, handed to a websocket_handler.
+// receive(), send(), ping() and close() belong to the handler's coroutine; post() may be called from any thread
+// (hold ws.shared_from_this() there) while the handler keeps receiving. Posts to a closed connection are dropped.
+class websocket : public std::enable_shared_from_this<websocket>
 {
 public:
-    static std::string simple_response_entity(int code, const std::string& status)
-    {
-        std::stringstream ss;
-        ss << "<html>"
-           << "<head><title>" << status << "</title></head>"
-           << "<body><h1>" << code << " " << status << "</h1></body>"
-           << "</html>";
+    enum message_type { text = 1, binary = 2 };
+    enum close_code { normal_closure = 1000, going_away = 1001, protocol_error = 1002, unsupported_data = 1003, invalid_payload = 1007, policy_violation = 1008, message_too_big = 1009, internal_error = 1011 };
 
-        return std::move(ss.str());
-    }
+    websocket(const websocket&) = delete;
+    websocket& operator=(const websocket&) = delete;
 
-    static void parase_uri(const std::string& uri, std::string& path, std::map<std::string, std::string>& parameters)
+    virtual ~websocket() {}
+
+    static bool is_upgrade(const request& rq)
     {
-        auto pos = uri.find_first_of('?');
-        path = detail::utils::decode_percent_encoding(uri.substr(0, pos));
-        if (pos != std::string::npos) {
-            detail::utils::parse_parameter(uri.substr(pos + 1), parameters);
-        }
+        return rq.method_view() == "GET" && boost::algorithm::iequals(rq.header_view("upgrade"), "websocket")
+            && boost::algorithm::icontains(rq.header_view("connection"), "upgrade") && !rq.header_view("sec-websocket-key").empty();
     }
 
-    static void parse_parameter(const std::string& src, std::map<std::string, std::string>& parameters)
+    // Waits for the next complete message, answering pings meanwhile; returns false once the connection is closed.
+    bool receive(std::string& message)
     {
-        std::vector<std::string> splitted;
-        boost::algorithm::split(splitted, src, boost::is_any_of("&"));
-        for (auto p : splitted) {
-            auto pos = p.find_first_of('=');
-            parameters[p.substr(0, pos)] = pos != std::string::npos ? detail::utils::decode_percent_encoding(p.substr(pos + 1)) : "";
-        }
+        message_type type;
+        return receive(message, type);
     }
 
-    static std::string decode_percent_encoding(const std::string& src)
+    bool receive(std::string& message, message_type& type);
+
+    // Queued for the writer; waits only while a slow peer has too much queued. Returns false once the connection is closed.
+    bool send(const std::string& message, message_type type = text) { return send(message.data(), message.size(), type); }
+
+    bool send(const void* data, std::size_t size, message_type type)
     {
-        std::string result;
-        char hex[3];
+        if (!is_open()) return false;
 
-        for (auto it = src.begin(); it != src.end(); ++it) {
-            if (*it == '%') {
-                if (++it == src.end()) break;
-                hex[0] = *it;
-                if (++it == src.end()) break;
-                hex[1] = *it;
-                hex[2] = '\0';
-                result.push_back(static_cast<char>(std::strtol(hex, nullptr, 16)));
-            } else {
-                result.push_back(*it);
-            }
-        }
-        return std::move(result);
+        queue_message(type, static_cast<const char*>(data), size);
+        while (!closed_ && pending_.size() >= max_pending_size) drainEvent_.wait(*yield_);
+        return !closed_;
     }
 
-    static std::string extension_to_mime_type(const std::string& extension)
+    void post(std::string message, message_type type = text)
     {
-        static const std::map<std::string, std::string> table = {{"gif", "image/gif"}, {"htm", "text/html"}, {"html", "text/html"}, {"jpg", "image/jpeg"}, {"jpeg", "image/jpeg"}, {"txt", "text/plain"}, {"png", "image/png"}};
+        auto self(shared_from_this());
+        boost::asio::post(strand_, [this, self, message = std::move(message), type]() {
+            if (is_open()) queue_message(type, message.data(), message.size());
+        });
+    }
 
-        auto it = table.find(extension.front()=='.' ? extension.substr(1) : extension);
-        return it != table.end() ? it->second : "text/plain";
+    void ping(const std::string& payload = "")
+    {
+        if (is_open()) queue_frame(op_ping, false, payload.data(), std::min<std::size_t>(payload.size(), 125));
     }
-};
 
-class handler_table
-{
-public:
-    handler_table() {}
+    void close(close_code code = normal_closure, const std::string& reason = "")
+    {
+        if (!is_open()) return;
 
-    void set_get_handler(const std::string& name, handler h) { getHandlers_[name] = h; }
-    void set_post_handler(const std::string& name, handler h) { postHandlers_[name] = h; }
-    void set_put_handler(const std::string& name, handler h) { putHandlers_[name] = h; }
+        std::string payload = { static_cast<char>(code >> 8), static_cast<char>(code & 0xff) };
+        payload += reason.substr(0, 123);
+        queue_frame(op_close, false, payload.data(), payload.size());
+        closeSent_ = true;
+    }
 
-    handler get_handler(const std::string& name, handler def = empty_handler) const { return find_handler(getHandlers_, def, name); }
-    handler post_handler(const std::string& name, handler def = empty_handler) const { return find_handler(postHandlers_, def, name); }
-    handler put_handler(const std::string& name, handler def = empty_handler) const { return find_handler(putHandlers_, def, name); }
+    bool is_open() const { return !closed_ && !closeSent_; }
 
-    static void empty_handler(request&, response&) {}
-private:
-    static handler find_handler(const std::map<std::string, handler>& handlers, const handler def, const std::string& name)
+    bool is_compressed() const
     {
-        auto it = handlers.find(name);
-        return (it != handlers.end() ? it->second : def);
+#ifdef BOOST_ASIO_HTTP_USE_ZLIB
+        return deflate_ != nullptr;
+#else
+        return false;
+#endif
     }
 
-    std::map<std::string, handler> getHandlers_, postHandlers_, putHandlers_;
-};
-
-class connection_manager;
+    void set_max_message_size(std::size_t n) { maxMessageSize_ = n; }
 
-class connection : public std::enable_shared_from_this<connection>
-{
-public:
-    connection(const connection&) = delete;
-    connection& operator=(const connection&) = delete;
+protected:
+    using strand_type = boost::asio::strand<boost::asio::io_context::executor_type>;
 
-    explicit connection(boost::asio::io_context& ioContext, boost::asio::ip::tcp::socket socket, connection_manager& manager, const std::string& docRoot, handler_table& handlers)
-        : strand_(ioContext.get_executor()), socket_(std::move(socket)), connectionManager_(manager), docRoot_(docRoot), handlerTable_(handlers) {}
+    websocket(detail::socket_streambuf_base& sb, strand_type strand)
+        : sb_(sb), strand_(strand), yield_(nullptr), maxMessageSize_(default_max_message_size),
+          closeSent_(false), closed_(false), finished_(false), writerRunning_(false), writerEvent_(strand), drainEvent_(strand) {}
 
-    void start() { do_process(); }
-    void stop() { socket_.close(); }
+    virtual void write(const std::string& data, boost::asio::yield_context yield, boost::system::error_code& ec) = 0;
+    virtual void abort() = 0;
 
 private:
-    void do_process();
-    void default_get_handler(request& rq, response& rs);
-    void default_post_handler(request& rq, response& rs);
-    void default_put_handler(request& rq, response& rs);
-
-    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
-    boost::asio::ip::tcp::socket socket_;
-    connection_manager& connectionManager_;
-    std::string docRoot_;
-    handler_table& handlerTable_;
-};
+    template <class> friend class detail::basic_connection;
 
-typedef std::shared_ptr<connection> connection_ptr;
+    enum opcode { op_continuation = 0, op_text = 1, op_binary = 2, op_close = 8, op_ping = 9, op_pong = 10 };
 
-class connection_manager
-{
-public:
-    connection_manager(const connection_manager&) = delete;
-    connection_manager& operator=(const connection_manager&) = delete;
+    static constexpr std::size_t default_max_message_size = 16 * 1024 * 1024;
+    static constexpr std::size_t max_pending_size = 256 * 1024;
 
-    connection_manager() {}
+    void run(request& rq, const websocket_handler& h, boost::asio::yield_context yield);
 
-    void start(connection_ptr c)
+    bool read_exact(void* data, std::size_t size)
     {
-        connections_.insert(c);
-        c->start();
+        return sb_.sgetn(static_cast<char*>(data), static_cast<std::streamsize>(size)) == static_cast<std::streamsize>(size);
     }
 
-    void stop(connection_ptr c)
+    bool fail(close_code code)
     {
-        connections_.erase(c);
-        c->stop();
+        close(code);
+        closed_ = true;
+        return false;
     }
 
-    void stop_all()
+    bool on_close(const std::string& payload)
     {
-        for (auto c : connections_) c->stop();
-        connections_.clear();
-    }
-private:
-    std::set<connection_ptr> connections_;
-};
+        if (payload.size() == 1) return fail(protocol_error);
+        if (payload.size() >= 2) {
+            int code = (static_cast<unsigned char>(payload[0]) << 8) | static_cast<unsigned char>(payload[1]);
+            bool valid = (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1011) || (code >= 3000 && code <= 4999);
+            if (!valid || !detail::utils::is_valid_utf8(payload.data() + 2, payload.size() - 2)) return fail(protocol_error);
+        }
 
-}   // namespace boost_asio_http::detail
+        // echo the status code, then the server closes the TCP connection
+        if (!closeSent_) queue_frame(op_close, false, payload.data(), std::min<std::size_t>(payload.size(), 2));
+        closeSent_ = true;
+        closed_ = true;
+        return false;
+    }
 
-class request
-{
-private:
-    friend class detail::connection;
+    void queue_message(message_type type, const char* data, std::size_t size)
+    {
+#ifdef BOOST_ASIO_HTTP_USE_ZLIB
+        if (deflate_) {
+            deflate_->compress(data, size, compressed_);
+            queue_frame(static_cast<opcode>(type), true, compressed_.data(), compressed_.size());
+            return;
+        }
+#endif
+        queue_frame(static_cast<opcode>(type), false, data, size);
+    }
 
-    request(detail::socket_streambuf* sb)
-        : is_(sb), contentLength_(0)
+    void queue_frame(opcode op, bool compressed, const char* data, std::size_t size)
     {
-        std::string uri;
+        unsigned char header[10] = { static_cast<unsigned char>(0x80 | (compressed ? 0x40 : 0) | op) };
+        std::size_t headerSize = 2;
+        if (size < 126) {
+            header[1] = static_cast<unsigned char>(size);
+        } else if (size <= 0xffff) {
+            header[1] = 126;
+            header[2] = static_cast<unsigned char>(size >> 8);
+            header[3] = static_cast<unsigned char>(size);
+            headerSize = 4;
+        } else {
+            header[1] = 127;
+            for (int i = 0; i < 8; i++) header[2 + i] = static_cast<unsigned char>(static_cast<std::uint64_t>(size) >> (56 - i * 8));
+            headerSize = 10;
+        }
 
-        for (int lineno = 0; ; lineno++) {
-            std::string line;
-            std::getline(is_, line, '\n');
-            if (is_.eof()) break;
+        pending_.append(reinterpret_cast<const char*>(header), headerSize);
+        pending_.append(data, size);
+        writerEvent_.notify();
+    }
 
-            if(line.back()=='\r') line.pop_back();
-            
-            if (lineno++ == 0) {
-                std::stringstream ss(line);
-                ss >> method_ >> uri >> protocol_;
-            } else {
-                const std::string contentLengthTag = "Content-Length:";
-                const std::string contentTypeTag = "Content-Type:";
-                if (line.find(contentLengthTag) == 0) {
-                    contentLength_ = std::strtol(line.data() + contentLengthTag.length(), nullptr, 10);
-                } else if (line.find(contentTypeTag) == 0) {
-                    contentType_ = line.substr(contentTypeTag.length());
-                    if (std::isspace(contentType_.front())) contentType_.erase(0, 1);
+    // Frames queued while a write is in flight go out together in the next write.
+    void start_writer()
+    {
+        auto self(shared_from_this());
+        writerRunning_ = true;
+        boost::asio::spawn(strand_, [this, self](boost::asio::yield_context yield) {
+            std::string writing;
+            for (;;) {
+                while (pending_.empty() && !finished_) writerEvent_.wait(yield);
+                if (pending_.empty()) break;
+
+                writing.swap(pending_);
+                boost::system::error_code ec;
+                write(writing, yield, ec);
+                writing.clear();
+                if (ec) {
+                    closed_ = true;
+                    pending_.clear();
+                    abort();
                 }
+                drainEvent_.notify();
             }
+            writerRunning_ = false;
+            drainEvent_.notify();
+        });
+    }
 
-            if (line.empty()) break;
+    detail::socket_streambuf_base& sb_;
+    strand_type strand_;
+    boost::asio::yield_context* yield_;
+    std::size_t maxMessageSize_;
+
+    std::string pending_;
+    bool closeSent_, closed_, finished_, writerRunning_;
+    detail::coroutine_event writerEvent_, drainEvent_;
+
+#ifdef BOOST_ASIO_HTTP_USE_ZLIB
+    std::unique_ptr<detail::permessage_deflate> deflate_;
+    std::string compressed_;
+#endif
+};
+
+inline bool websocket::receive(std::string& message, message_type& type)
+{
+    message.clear();
+    bool started = false;
+#ifdef BOOST_ASIO_HTTP_USE_ZLIB
+    bool compressed = false;
+#endif
+
+    while (!closed_) {
+        unsigned char header[2];
+        if (!read_exact(header, sizeof(header))) break;
+
+        bool fin = (header[0] & 0x80) != 0;
+        bool rsv1 = (header[0] & 0x40) != 0;
+        int op = header[0] & 0x0f;
+        std::uint64_t length = header[1] & 0x7f;
+        bool control = (op & 0x8) != 0;
+
+        // clients must mask; RSV1 marks a compressed message and only on its first frame
+        if ((header[0] & 0x30) || !(header[1] & 0x80)) return fail(protocol_error);
+        if (control ? (!fin || rsv1 || length > 125 || op > op_pong)
+                    : (op > op_binary || (op == op_continuation) != started || (rsv1 && (op == op_continuation || !is_compressed())))) {
+            return fail(protocol_error);
+        }
+
+        unsigned char extended[8];
+        std::size_t extendedSize = length == 126 ? 2 : length == 127 ? 8 : 0;
+        if (extendedSize > 0) {
+            if (!read_exact(extended, extendedSize)) break;
+            length = 0;
+            for (std::size_t i = 0; i < extendedSize; i++) length = (length << 8) | extended[i];
         }
 
-        detail::utils::parase_uri(uri, path_, parameters_);
+        unsigned char key[4];
+        if (!read_exact(key, sizeof(key))) break;
 
-        if (method_ == "POST" || method_ == "PUT") sb->set_remained_size(contentLength_);
+        if (control) {
+            std::string payload(static_cast<std::size_t>(length), '\0');
+            if (length > 0 && !read_exact(&payload[0], payload.size())) break;
+            detail::utils::apply_mask(&payload[0], payload.size(), key);
 
-        if (method_ == "POST" && contentType_ == "application/x-www-form-urlencoded") {
-            std::stringstream data;
-            data << is_.rdbuf();
-            detail::utils::parse_parameter(data.str(), parameters_);
+            if (op == op_ping) {
+                queue_frame(op_pong, false, payload.data(), payload.size());
+            } else if (op == op_close) {
+                return on_close(payload);
+            }
+            continue;
         }
-    }
 
-public:
-    std::string method() const { return method_; }
-    std::string path() const { return path_; }
-    std::string protocol() const { return protocol_; }
+        if (length > maxMessageSize_ - message.size()) return fail(message_too_big);
+        if (!started) {
+            started = true;
+            type = static_cast<message_type>(op);
+#ifdef BOOST_ASIO_HTTP_USE_ZLIB
+            compressed = rsv1;
+#endif
+        }
 
-    std::streamsize content_length() const { return contentLength_; }
-    std::string content_type() const { return contentType_; }
-    std::istream& stream() { return is_; }
+        std::size_t offset = message.size();
+        message.resize(offset + static_cast<std::size_t>(length));
+        if (length > 0 && !read_exact(&message[offset], static_cast<std::size_t>(length))) break;
+        detail::utils::apply_mask(&message[offset], static_cast<std::size_t>(length), key);
+        if (!fin) continue;
 
-    std::vector<std::string> parameter_names() const
-    {
-        std::vector<std::string> result;
-        for (auto e : parameters_) {
-            result.push_back(e.first);
+#ifdef BOOST_ASIO_HTTP_USE_ZLIB
+        if (compressed) {
+            detail::permessage_deflate::result r = deflate_->decompress(message, maxMessageSize_);
+            if (r != detail::permessage_deflate::ok) return fail(r == detail::permessage_deflate::too_big ? message_too_big : invalid_payload);
         }
-        return result;
+#endif
+        if (type == text && !detail::utils::is_valid_utf8(message.data(), message.size())) return fail(invalid_payload);
+        return true;
     }
 
-    std::string parameter(const std::string& name) const
-    {
-        auto it = parameters_.find(name);
-        return it != parameters_.end() ? it->second : "";
-    }
-private:
-    std::istream is_;
-    std::string method_, path_, protocol_;
-    std::map<std::string, std::string> parameters_;
-    std::streamsize contentLength_;
-    std::string contentType_;
-};
+    closed_ = true;     // the peer is gone
+    return false;
+}
 
-class response
+inline void websocket::run(request& rq, const websocket_handler& h, boost::asio::yield_context yield)
 {
-public:
-    enum code { ok = 200, bad_request = 400, forbidden = 403, not_found = 404, internal_server_error = 500 };
-private:
-    friend class detail::connection;
+    yield_ = &yield;
 
-    response(detail::socket_streambuf* sb)
-        : os_(sb), code_(ok), headerWritten_(false), contentType_("text/html"), contentLength_(detail::uninitialized_content_length), closed_(false)
-    {
+    std::ostream os(&sb_);
+    if (rq.header("sec-websocket-version") != "13") {
+        os << "HTTP/1.1 426 Upgrade Required\r\nSec-WebSocket-Version: 13\r\nContent-Length: 0\r\n\r\n";
+        os.flush();
+        return;
     }
-    void flush_header()
-    {
-        if (headerWritten_) return;
-
-        os_ << "HTTP/1.1 " << code_ << " " << status(code_) << "\r\n";
-        os_ << "Content-Type: " << contentType_ << "\r\n";
-        if (contentLength_ != detail::uninitialized_content_length) {
-            os_ << "Content-Length: " << contentLength_ << "\r\n";
-        }
-        os_ << "\r\n";
 
-        headerWritten_ = true;
+    const std::string guid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    os << "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+       << "Sec-WebSocket-Accept: " << detail::utils::encode_base64(detail::utils::sha1(rq.header("sec-websocket-key") + guid)) << "\r\n";
+#ifdef BOOST_ASIO_HTTP_USE_ZLIB
+    int windowBits;
+    bool noContextTakeover;
+    std::string extension = detail::permessage_deflate::negotiate(rq.header("sec-websocket-extensions"), windowBits, noContextTakeover);
+    if (!extension.empty()) {
+        deflate_.reset(new detail::permessage_deflate(windowBits, noContextTakeover));
+        os << "Sec-WebSocket-Extensions: " << extension << "\r\n";
+    }
+#endif
+    os << "\r\n";
+    os.flush();
+    if (!os) return;
+
+    start_writer();
+    try {
+        h(rq, *this);
+        close(normal_closure);
+    } catch (...) {
+        close(internal_error);
     }
 
-    static std::string status(code c)
-    {
-        static std::map<code, std::string> table = { {ok, "OK"}, {bad_request, "Bad Request"}, {forbidden, "Forbidden"}, {not_found, "Not Found"}, {internal_server_error, "Internal Server Error"}};
-        auto it = table.find(c);
-        return it != table.end() ? it->second : "OK";
+    // give the peer a moment to answer our close frame
+    if (!closed_) {
+        auto self(shared_from_this());
+        boost::asio::steady_timer timer(strand_, std::chrono::seconds(1));
+        timer.async_wait([this, self](boost::system::error_code ec) {
+            if (!ec) abort();
+        });
+        std::string message;
+        while (receive(message)) {}
+        timer.cancel();
     }
 
-public:
-    void close()
-    {
-        if (closed_) return;
+    closed_ = true;
+    finished_ = true;
+    writerEvent_.notify();
+    while (writerRunning_) drainEvent_.wait(yield);
+}
 
-        flush_header();
-        os_.flush();
-        closed_ = true;
-    }
+namespace detail {
 
-    void set_code(code code) { code_ = code; }
-    void set_content_type(const std::string& type) { contentType_ = type; }
-    void set_content_length(std::streamsize n) { contentLength_ = n; }
+template <class Stream>
+class websocket_session : public websocket
+{
+public:
+    websocket_session(Stream& stream, socket_streambuf_base& sb, strand_type strand)
+        : websocket(sb, strand), stream_(stream) {}
 
-    std::ostream& stream()
+protected:
+    void write(const std::string& data, boost::asio::yield_context yield, boost::system::error_code& ec) override
     {
-        flush_header();
-        return os_;
+        boost::asio::async_write(stream_, boost::asio::buffer(data), yield[ec]);
     }
 
-    void simple_response(code code)
+    void abort() override
     {
-        std::string entity = detail::utils::simple_response_entity(code, status(code));
-
-        set_code(code);
-        set_content_length(entity.length());
-        set_content_type("text/html");
-
-        std::ostream& os = stream();
-        os << entity;
-        os.flush();
+        boost::system::error_code ec;
+        stream_.lowest_layer().close(ec);
     }
+
 private:
-    std::ostream os_;
-    bool headerWritten_;
-    bool closed_;
-    code code_;
-    std::string contentType_;
-    std::streamsize contentLength_;
+    Stream& stream_;
 };
 
-inline void detail::connection::do_process()
+}   // namespace boost_asio_http::detail
+
+template <class Stream>
+inline void detail::basic_connection<Stream>::do_process()
 {
-    auto self(shared_from_this());
+    auto self(this->shared_from_this());
 
     boost::asio::spawn(strand_, [this, self](boost::asio::yield_context yield) {
         try {
             boost::system::error_code ec;
             bool headerReceived = false;
 
-            socket_streambuf sb(socket_, yield);
-            request rq(&sb);
-            response rs(&sb);
+            stream_traits<Stream>::handshake(stream_, yield, ec);
+            if (ec) throw boost::system::system_error(ec);
+
+            basic_socket_streambuf<Stream> sb(stream_, yield);
+            arena_.reset();
+            request rq(&sb, arena_);
+
+            // an Upgrade to a path without a WebSocket handler is served as a plain GET
+            websocket_handler wsHandler = websocket::is_upgrade(rq) ? handlerTable_.lookup_websocket_handler(rq.path_view()) : websocket_handler();
+
+            if (rq.rejectCode_ != 0) {
+                response rs(&sb);
+                rs.simple_response(static_cast<response::code>(rq.rejectCode_));
+                rs.close();
+            } else if (wsHandler) {
+                auto ws = std::make_shared<websocket_session<Stream>>(stream_, sb, strand_);
+                ws->run(rq, wsHandler, yield);
+            } else if (stream_traits<Stream>::cleartext_http2 && (http2_session<Stream>::is_prior_knowledge(rq) || http2_session<Stream>::is_upgrade(rq))) {
+                http2_session<Stream> session(stream_, sb, strand_, [this](request& rq, response& rs) { select_handler(rq)(rq, rs); });
+                session.run(rq, yield);
+            } else {
+                // clients sending large bodies may wait for this before they start; HTTP/1.0 has no interim responses
+                if (rq.protocol_view() == "HTTP/1.1" && boost::algorithm::iequals(rq.header_view("expect"), "100-continue")) {
+                    sb.expect_continue();
+                }
 
-            handler h = detail::handler_table::empty_handler;
-            if (rq.method() == "GET") {
-                h = handlerTable_.get_handler(rq.path(), [&](request& rq, response& rs) { return default_get_handler(rq, rs); });
-            } else if (rq.method() == "POST") {
-                h = handlerTable_.post_handler(rq.path(), [&](request& rq, response& rs) { return default_post_handler(rq, rs); });
-            } else if (rq.method() == "PUT") {
-                h = handlerTable_.put_handler(rq.path(), [&](request& rq, response& rs) { return default_put_handler(rq, rs); });
+                response rs(&sb);
+                select_handler(rq)(rq, rs);
+                rs.close();
             }
-            h(rq, rs);
-
-            rs.close();
+            stream_traits<Stream>::shutdown(stream_, yield, ec);
         } catch (...) {
         }
 
-        connectionManager_.stop(shared_from_this());
+        connectionManager_.stop(self);
     });
 }
 
-inline void detail::connection::default_get_handler(request& rq, response& rs)
+template <class Stream>
+inline handler detail::basic_connection<Stream>::select_handler(const request& rq)
+{
+    if (rq.method_view() == "GET") {
+        return handlerTable_.get_handler(rq.path_view(), [this](request& rq, response& rs) { return default_get_handler(rq, rs); });
+    } else if (rq.method_view() == "POST") {
+        return handlerTable_.post_handler(rq.path_view(), [this](request& rq, response& rs) { return default_post_handler(rq, rs); });
+    } else if (rq.method_view() == "PUT") {
+        return handlerTable_.put_handler(rq.path_view(), [this](request& rq, response& rs) { return default_put_handler(rq, rs); });
+    }
+    return detail::handler_table::empty_handler;
+}
+
+template <class Stream>
+inline void detail::basic_connection<Stream>::default_get_handler(request& rq, response& rs)
 {
     if (rq.path().empty() || rq.path().front()!='/' || rq.path().find("..") != std::string::npos) { // prevent path traversal attack
         rs.simple_response(response::bad_request);
@@ -447,12 +3526,14 @@ inline void detail::connection::default_get_handler(request& rq, response& rs)
     os.flush();
 }
 
-inline void detail::connection::default_post_handler(request& rq, response& rs)
+template <class Stream>
+inline void detail::basic_connection<Stream>::default_post_handler(request& rq, response& rs)
 {
     rs.simple_response(response::bad_request);
 }
 
-inline void detail::connection::default_put_handler(request& rq, response& rs)
+template <class Stream>
+inline void detail::basic_connection<Stream>::default_put_handler(request& rq, response& rs)
 {
     boost::filesystem::path path(docRoot_);
     path /= rq.path();
@@ -472,19 +3553,30 @@ inline void detail::connection::default_put_handler(request& rq, response& rs)
     rs.set_content_type("text/html");
 }
 
-class server
+template <class Stream>
+class basic_server
 {
 public:
-    server(const server&) = delete;
-    server& operator=(const server&) = delete;
+    using context_type = typename detail::stream_traits<Stream>::context_type;
+
+    basic_server(const basic_server&) = delete;
+    basic_server& operator=(const basic_server&) = delete;
+
+    explicit basic_server(const std::string& address, const std::string& port, const std::string& docRoot)
+        : basic_server(address, port, docRoot, default_context()) {}
+
+    // Listens on no TCP port; add Unix domain sockets by listen_local().
+    explicit basic_server(const std::string& docRoot)
+        : ioContext_(1), acceptor_(ioContext_), valid_(false), acceptorOpened_(false), docRoot_(docRoot), context_(default_context()) {}
 
-    explicit server(const std::string& address, const std::string& port, const std::string& docRoot)
-        : ioContext_(1), acceptor_(ioContext_), docRoot_(docRoot), valid_(false), acceptorOpened_(false)
+    explicit basic_server(const std::string& address, const std::string& port, const std::string& docRoot, context_type& context)
+        : ioContext_(1), acceptor_(ioContext_), valid_(false), acceptorOpened_(false), docRoot_(docRoot), context_(context)
     {
         try {
             boost::asio::ip::tcp::resolver resolver(ioContext_);
             boost::asio::ip::tcp::endpoint endpoint = *resolver.resolve(address, port).begin();
             acceptor_.open(endpoint.protocol());
+            acceptor_.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
             acceptor_.bind(endpoint);
             acceptor_.listen();
             acceptorOpened_ = true;
@@ -495,20 +3587,78 @@ public:
         }
     }
 
+    // Whether the TCP port is listening; Unix domain sockets are reported by is_listening_local().
     bool is_valid() const { return valid_; }
     void run() { ioContext_.run(); }
 
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    bool is_listening_local() const { return !localAcceptors_.empty(); }
+
+    // Also accepts plain HTTP on a Unix domain socket, served by the same handlers; call before run().
+    // A stale socket file at 'path' is replaced, but one that still accepts connections fails as in use; 'permissions' is applied before the socket starts listening.
+    bool listen_local(const std::string& path, boost::filesystem::perms permissions = boost::filesystem::owner_read | boost::filesystem::owner_write | boost::filesystem::group_read | boost::filesystem::group_write)
+    {
+        try {
+            boost::asio::local::stream_protocol::endpoint endpoint(path);
+            boost::system::error_code ec;
+            if (boost::filesystem::status(path, ec).type() == boost::filesystem::socket_file) {
+                // a socket file left by a process that is gone refuses connections; a live one is in use
+                boost::asio::local::stream_protocol::socket probe(ioContext_);
+                probe.connect(endpoint, ec);
+                if (ec != boost::asio::error::connection_refused) return false;
+                boost::filesystem::remove(path);
+            }
+
+            auto acceptor = std::make_shared<local_acceptor>(ioContext_);
+            acceptor->open();
+            acceptor->bind(endpoint);
+            try {
+                boost::filesystem::permissions(path, permissions);
+                acceptor->listen();
+            } catch (const boost::system::system_error&) {
+                // the file bind() created would make the next attempt fail as in use
+                acceptor->close(ec);
+                boost::filesystem::remove(path, ec);
+                throw;
+            }
+
+            localAcceptors_.push_back(acceptor);
+            do_accept_local(acceptor);
+            return true;
+        } catch (const boost::system::system_error&) {      // including boost::filesystem::filesystem_error
+        }
+        return false;
+    }
+#endif
+
     void stop()
     {
-        acceptorOpened_ = false;
-        acceptor_.close();
-        connectionManager_.stop_all();
+        // run() is usually on another thread; connections are only touched from the io_context.
+        boost::asio::post(ioContext_, [this]() {
+            acceptorOpened_ = false;
+            acceptor_.close();
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+            for (auto& acceptor : localAcceptors_) {
+                boost::system::error_code ec;
+                std::string path = acceptor->local_endpoint(ec).path();
+                acceptor->close(ec);
+                if (!path.empty()) boost::filesystem::remove(path, ec);
+            }
+#endif
+            connectionManager_.stop_all();
+        });
     }
 
     // API registration
     void set_get_handler(const std::string& name, handler h) { handlerTable_.set_get_handler(name, h); }
+    // Serves repeated GETs of the same path and parameters from the handler's stored response for 'ttl', keeping at most 'maxEntries' of them.
+    void set_get_handler(const std::string& name, handler h, std::chrono::milliseconds ttl, std::size_t maxEntries = detail::default_max_cache_entries)
+    {
+        handlerTable_.set_get_handler(name, detail::response_cache::wrap(h, ttl, maxEntries));
+    }
     void set_post_handler(const std::string& name, handler h) { handlerTable_.set_post_handler(name, h); }
     void set_put_handler(const std::string& name, handler h) { handlerTable_.set_put_handler(name, h); }
+    void set_websocket_handler(const std::string& name, websocket_handler h) { handlerTable_.set_websocket_handler(name, h); }
 
 private:
     void do_accept()
@@ -517,22 +3667,56 @@ private:
             if (!acceptorOpened_ || !acceptor_.is_open()) return;
 
             if (!ec) {
-                connectionManager_.start(std::make_shared<detail::connection>(ioContext_, std::move(socket), connectionManager_, docRoot_, handlerTable_));
+                connectionManager_.start(std::make_shared<detail::basic_connection<Stream>>(ioContext_, detail::stream_traits<Stream>::create(std::move(socket), context_), connectionManager_, docRoot_, handlerTable_));
             }
             do_accept();
         });
     }
 
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    using local_acceptor = boost::asio::local::stream_protocol::acceptor;
+
+    void do_accept_local(std::shared_ptr<local_acceptor> acceptor)
+    {
+        acceptor->async_accept([this, acceptor](boost::system::error_code ec, boost::asio::local::stream_protocol::socket socket) {
+            if (!acceptor->is_open()) return;
+
+            if (!ec) {
+                connectionManager_.start(std::make_shared<detail::basic_connection<boost::asio::local::stream_protocol::socket>>(ioContext_, std::move(socket), connectionManager_, docRoot_, handlerTable_));
+            }
+            do_accept_local(acceptor);
+        });
+    }
+#endif
+
+    // Only streams that need no context have a default one; an ssl_server must be given its certificate.
+    static context_type& default_context()
+    {
+        static_assert(std::is_same<context_type, detail::no_context>::value, "ssl_server requires an ssl_context holding the certificate");
+        static context_type context;
+        return context;
+    }
+
     boost::asio::io_context ioContext_;
     boost::asio::ip::tcp::acceptor acceptor_;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    std::vector<std::shared_ptr<local_acceptor>> localAcceptors_;
+#endif
     bool valid_;
     bool acceptorOpened_;
 
     detail::connection_manager connectionManager_;
     std::string docRoot_;
     detail::handler_table handlerTable_;
+    context_type& context_;
 };
 
+using server = basic_server<boost::asio::ip::tcp::socket>;
+
+#ifdef BOOST_ASIO_HTTP_USE_SSL
+using ssl_server = basic_server<boost::asio::ssl::stream<boost::asio::ip::tcp::socket>>;
+#endif
+
 }   // namespace boost_asio_http
 
 #endif // BOOST_ASIO_HTTP_HPP
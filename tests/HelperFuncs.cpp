@@ -3,8 +3,11 @@
 #include <algorithm>
 #include <string>
 #include <boost/process.hpp>
+#include <boost/asio.hpp>
 
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <boost/filesystem.hpp>
 
 #ifdef _WIN32
@@ -42,8 +45,85 @@ void testPost(const std::string& uri, const std::vector<std::string>& parameters
 	child.join();
 }
 
+void testGetHeaders(const std::string& uri, const std::string& headerPath, const std::string& outPath, bool http2)
+{
+	boost::process::system(CURL, http2 ? "--http2-prior-knowledge" : "--http1.1", uri, "-D", headerPath, "-o", outPath);
+}
+
+void testPostMultipart(const std::string& uri, const std::vector<std::string>& fields, const std::string& outPath)
+{
+	std::vector<std::string> args;
+	for (auto f : fields) {
+		args.push_back("-F");
+		args.push_back(f);
+	}
+	args.push_back(uri);
+	args.push_back("-o");
+	args.push_back(outPath);
+
+	boost::process::child child(CURL, boost::process::args(args));
+	child.join();
+}
+
+void testGetHttp2(const std::string& uri, const std::string& outPath, bool priorKnowledge)
+{
+	boost::process::system(CURL, priorKnowledge ? "--http2-prior-knowledge" : "--http2", uri, "-o", outPath);
+}
+
+void testPutHttp2(const std::string& uri, const std::string& inPath, const std::string& outPath)
+{
+	boost::process::system(CURL, "--http2-prior-knowledge", uri, "-T", inPath, "-o", outPath);
+}
+
+void testGetHttp2Parallel(const std::vector<std::string>& uris, const std::vector<std::string>& outPaths)
+{
+	std::vector<std::string> args;
+	args.push_back("--http2");
+	args.push_back("--parallel");
+	for (std::size_t i = 0; i < uris.size(); i++) {
+		args.push_back(uris[i]);
+		args.push_back("-o");
+		args.push_back(outPaths[i]);
+	}
+
+	boost::process::child child(CURL, boost::process::args(args));
+	child.join();
+}
+
+void testGetUnixSocket(const std::string& socketPath, const std::string& uri, const std::string& outPath)
+{
+	boost::process::system(CURL, "--unix-socket", socketPath, uri, "-o", outPath);
+}
+
+void testPutUnixSocket(const std::string& socketPath, const std::string& uri, const std::string& inPath, const std::string& outPath)
+{
+	boost::process::system(CURL, "--unix-socket", socketPath, uri, "-T", inPath, "-o", outPath);
+}
+
+std::string testRawRequest(const std::string& port, const std::string& request)
+{
+	boost::asio::io_context ioContext;
+	boost::asio::ip::tcp::socket socket(ioContext);
+	boost::asio::ip::tcp::resolver resolver(ioContext);
+	boost::asio::connect(socket, resolver.resolve("127.0.0.1", port));
+
+	boost::system::error_code ec;
+	boost::asio::write(socket, boost::asio::buffer(request), ec);
+	std::string response;
+	boost::asio::read(socket, boost::asio::dynamic_buffer(response), ec);
+	return response;
+}
+
 bool compareFiles(const std::string& filePath1, const std::string& filePath2)
 {
 	int ret = boost::process::system(DIFF, filePath1, filePath2);
 	return ret == 0;
 }
+
+std::string readFile(const std::string& filePath)
+{
+	std::ifstream file(filePath, std::ios::binary);
+	std::stringstream ss;
+	ss << file.rdbuf();
+	return ss.str();
+}
@@ -7,8 +7,21 @@
 void testGet(const std::string& uri, const std::string& outPath);
 void testPut(const std::string& uri, const std::string& inPath, const std::string& outPath);
 void testPost(const std::string& uri, const std::vector<std::string>& parameters, const std::string& outPath);
+void testGetHeaders(const std::string& uri, const std::string& headerPath, const std::string& outPath, bool http2);
+void testPostMultipart(const std::string& uri, const std::vector<std::string>& fields, const std::string& outPath);
+
+void testGetHttp2(const std::string& uri, const std::string& outPath, bool priorKnowledge);
+void testPutHttp2(const std::string& uri, const std::string& inPath, const std::string& outPath);
+void testGetHttp2Parallel(const std::vector<std::string>& uris, const std::vector<std::string>& outPaths);
+
+void testGetUnixSocket(const std::string& socketPath, const std::string& uri, const std::string& outPath);
+void testPutUnixSocket(const std::string& socketPath, const std::string& uri, const std::string& inPath, const std::string& outPath);
+
+// Sends 'request' as is to localhost and returns everything received until the server closes.
+std::string testRawRequest(const std::string& port, const std::string& request);
 
 bool compareFiles(const std::string& filePath1, const std::string& filePath2);
+std::string readFile(const std::string& filePath);
 
 #endif
 
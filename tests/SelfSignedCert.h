@@ -0,0 +1,49 @@
+#ifndef SELF_SIGNED_CERT_H
+#define SELF_SIGNED_CERT_H
+
+// Shared by the TLS tests and benchmarks/tls_handshake.
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include <string>
+
+// Creates a throwaway RSA-2048 key and a self-signed certificate for "localhost".
+inline void makeSelfSigned(std::string& certPem, std::string& keyPem)
+{
+	EVP_PKEY_CTX* kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+	EVP_PKEY* key = nullptr;
+	EVP_PKEY_keygen_init(kctx);
+	EVP_PKEY_CTX_set_rsa_keygen_bits(kctx, 2048);
+	EVP_PKEY_keygen(kctx, &key);
+	EVP_PKEY_CTX_free(kctx);
+
+	X509* cert = X509_new();
+	ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+	X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+	X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 60 * 60);
+	X509_set_pubkey(cert, key);
+	X509_NAME* name = X509_get_subject_name(cert);
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+	X509_set_issuer_name(cert, name);
+	X509_sign(cert, key, EVP_sha256());
+
+	char* data = nullptr;
+	BIO* bio = BIO_new(BIO_s_mem());
+	PEM_write_bio_X509(bio, cert);
+	long n = BIO_get_mem_data(bio, &data);
+	certPem.assign(data, n);
+	BIO_free(bio);
+
+	bio = BIO_new(BIO_s_mem());
+	PEM_write_bio_PrivateKey(bio, key, nullptr, nullptr, 0, nullptr, nullptr);
+	n = BIO_get_mem_data(bio, &data);
+	keyPem.assign(data, n);
+	BIO_free(bio);
+
+	X509_free(cert);
+	EVP_PKEY_free(key);
+}
+
+#endif
@@ -3,6 +3,7 @@
 #include <boost/iostreams/stream.hpp>
 #include <boost/iostreams/device/null.hpp>
 #include <iostream>
+#include <stdexcept>
 
 void hello(boost_asio_http::request& rq, boost_asio_http::response& rs)
 {
@@ -28,6 +29,60 @@ void postForm(boost_asio_http::request& rq, boost_asio_http::response& rs)
 	            << "</ul></body></html>";
 }
 
+void listParameters(boost_asio_http::request& rq, boost_asio_http::response& rs)
+{
+	rs.set_code(boost_asio_http::response::ok);
+	rs.set_content_type("text/plain");
+
+	rs.stream() << rq.method_view() << " " << rq.path_view() << "\n";
+	for (const auto& parameter : rq.parameters()) {
+		rs.stream() << parameter.first << "=" << parameter.second << "\n";
+	}
+}
+
+void customHeaders(boost_asio_http::request&, boost_asio_http::response& rs)
+{
+	rs.set_code(boost_asio_http::response::created);
+	rs.set_content_type("text/plain");
+	rs.set_header("Cache-Control", "no-cache");
+	rs.add_header("X-Tag", "first");
+	rs.add_header("X-Tag", "second");
+	rs.set_header("cache-control", "no-store");
+	rs.set_header("Content-Type", "text/plain; charset=utf-8");	// goes to set_content_type()
+
+	// framing headers, control characters and negative lengths are refused
+	int rejected = 0;
+	std::pair<std::string, std::string> invalid[] = { {"Connection", "close"}, {"Transfer-Encoding", "chunked"}, {"X-Split", "a\r\nX-Injected: b"},
+	                                                   {std::string("X-Nul\0", 6), "a"}, {"X-Nul", std::string("a\0b", 3)}, {"Content-Length", "-1"}, {"Content-Length", "12abc"} };
+	for (auto& field : invalid) {
+		try {
+			rs.add_header(field.first, field.second);
+		} catch (const std::invalid_argument&) {
+			rejected++;
+		}
+	}
+	try {
+		rs.set_content_length(-1);
+	} catch (const std::invalid_argument&) {
+		rejected++;
+	}
+	rs.add_header("X-Rejected", std::to_string(rejected));
+
+	rs.stream() << "created";
+
+	// the header is gone once the body has started
+	try {
+		rs.set_header("X-Late", "1");
+	} catch (const std::logic_error&) {
+		rs.stream() << ", late header refused";
+	}
+}
+
+void unregisteredStatus(boost_asio_http::request&, boost_asio_http::response& rs)
+{
+	rs.simple_response(static_cast<boost_asio_http::response::code>(599));
+}
+
 void putToNull(boost_asio_http::request& rq, boost_asio_http::response& rs)
 {
 	std::streamsize contentLength = rq.content_length();
@@ -39,4 +94,40 @@ void putToNull(boost_asio_http::request& rq, boost_asio_http::response& rs)
 	rs.set_content_type("text/plain");
 
 	rs.stream() << contentLength;
-}
\ No newline at end of file
+}
+
+void upload(boost_asio_http::request& rq, boost_asio_http::response& rs)
+{
+	std::stringstream ss;
+
+	boost_asio_http::multipart_reader parts(rq);
+	while (parts.next()) {
+		if (parts.filename().empty()) {
+			std::stringstream value;
+			value << parts.stream().rdbuf();
+			ss << parts.name() << ": " << value.str() << "\n";
+		} else {
+			parts.stream().ignore(std::numeric_limits<std::streamsize>::max());
+			ss << parts.name() << ": " << parts.filename() << " (" << parts.stream().gcount() << " bytes)\n";
+		}
+	}
+
+	rs.set_code(boost_asio_http::response::ok);
+	rs.set_content_type("text/plain");
+
+	rs.stream() << ss.str();
+}
+
+void echoWebSocket(boost_asio_http::request&, boost_asio_http::websocket& ws)
+{
+	std::string message;
+	boost_asio_http::websocket::message_type type;
+
+	while (ws.receive(message, type)) {
+		if (message == "bye") {
+			ws.close(boost_asio_http::websocket::going_away, "bye");
+		} else {
+			ws.send(message, type);
+		}
+	}
+}
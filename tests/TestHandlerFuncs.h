@@ -5,7 +5,12 @@
 
 void hello(boost_asio_http::request& rq, boost_asio_http::response& rs);
 void postForm(boost_asio_http::request& rq, boost_asio_http::response& rs);
+void listParameters(boost_asio_http::request& rq, boost_asio_http::response& rs);
+void customHeaders(boost_asio_http::request& rq, boost_asio_http::response& rs);
+void unregisteredStatus(boost_asio_http::request& rq, boost_asio_http::response& rs);
 void putToNull(boost_asio_http::request& rq, boost_asio_http::response& rs);
+void upload(boost_asio_http::request& rq, boost_asio_http::response& rs);
+void echoWebSocket(boost_asio_http::request& rq, boost_asio_http::websocket& ws);
 
 #endif
 
@@ -21,7 +21,15 @@ public:
 
 		server_->set_get_handler("/Hello", hello);
 		server_->set_post_handler("/PostForm", postForm);
+		server_->set_get_handler("/Parameters", listParameters);
+		server_->set_get_handler("/CustomHeaders", customHeaders);
+		server_->set_get_handler("/UnregisteredStatus", unregisteredStatus);
 		server_->set_put_handler("/PutToNull", putToNull);
+		server_->set_post_handler("/Upload", upload);
+		server_->set_websocket_handler("/Echo", echoWebSocket);
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+		server_->listen_local("./test.sock");
+#endif
 
 		thread_ = std::make_shared<std::thread>(&boost_asio_http::server::run, server_.get());
 	}
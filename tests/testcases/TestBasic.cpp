@@ -2,6 +2,25 @@
 
 #include "../HelperFuncs.h"
 
+#include <boost/asio.hpp>
+
+// Sends the header block of a PUT /PutToNull with a 4-byte body held back; returns what arrives within 'wait'.
+static std::string sendExpectContinue(boost::asio::io_context& ioContext, boost::asio::ip::tcp::socket& socket, const std::string& protocol, std::chrono::milliseconds wait)
+{
+	socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 8080));
+	boost::asio::write(socket, boost::asio::buffer("PUT /PutToNull " + protocol + "\r\nContent-Length: 4\r\nExpect: 100-continue\r\n\r\n"));
+
+	std::string received;
+	boost::asio::async_read_until(socket, boost::asio::dynamic_buffer(received), "\r\n\r\n", [](const boost::system::error_code&, std::size_t) {});
+	ioContext.run_for(wait);
+	if (!ioContext.stopped()) {
+		socket.cancel();
+		ioContext.run();
+	}
+	ioContext.restart();
+	return received;
+}
+
 BOOST_AUTO_TEST_SUITE(TestBasic)
 
 BOOST_AUTO_TEST_CASE(testGetMethod)
@@ -28,4 +47,52 @@ BOOST_AUTO_TEST_CASE(testPutMethod)
 	BOOST_CHECK_EQUAL(true, check);
 }
 
+BOOST_AUTO_TEST_CASE(testInvalidContentLength)
+{
+	const char* invalid[] = { "12abc", "-1", "", "1000000000000000000000", "4\r\nContent-Length: 5" };
+	for (auto value : invalid) {
+		std::string response = testRawRequest("8080", std::string("PUT /PutToNull HTTP/1.1\r\nContent-Length: ") + value + "\r\n\r\nabcd");
+		BOOST_CHECK_MESSAGE(response.find("HTTP/1.1 400 ") == 0, "Content-Length: " << value);
+	}
+
+	std::string response = testRawRequest("8080", "PUT /PutToNull HTTP/1.1\r\nContent-Length: 4\r\nContent-Length: 4\r\n\r\nabcd");
+	BOOST_CHECK_EQUAL(0u, response.find("HTTP/1.1 200 "));
+	BOOST_CHECK_EQUAL(std::string("\r\n\r\n4"), response.substr(response.size() - 5));
+}
+
+BOOST_AUTO_TEST_CASE(testHeaderTooLarge)
+{
+	std::string response = testRawRequest("8080", "GET /Hello?greeting=Hello HTTP/1.1\r\nX-Padding: " + std::string(8 * 1024, 'x') + "\r\n\r\n");
+	BOOST_CHECK_EQUAL(0u, response.find("HTTP/1.1 431 "));
+
+	response = testRawRequest("8080", "GET /Hello?greeting=Hello HTTP/1.1\r\nX-Padding: " + std::string(7 * 1024, 'x') + "\r\n\r\n");
+	BOOST_CHECK_EQUAL(0u, response.find("HTTP/1.1 200 "));
+}
+
+BOOST_AUTO_TEST_CASE(testExpectContinue)
+{
+	boost::asio::io_context ioContext;
+	boost::system::error_code ec;
+	std::string response;
+
+	// the interim response comes before the body is sent
+	boost::asio::ip::tcp::socket http11(ioContext);
+	BOOST_CHECK_EQUAL(std::string("HTTP/1.1 100 Continue\r\n\r\n"), sendExpectContinue(ioContext, http11, "HTTP/1.1", std::chrono::seconds(5)));
+	boost::asio::write(http11, boost::asio::buffer(std::string("abcd")));
+	boost::asio::read(http11, boost::asio::dynamic_buffer(response), ec);
+	BOOST_CHECK_EQUAL(0u, response.find("HTTP/1.1 200 "));
+
+	// HTTP/1.0 clients can't parse it
+	boost::asio::ip::tcp::socket http10(ioContext);
+	BOOST_CHECK_EQUAL(std::string(), sendExpectContinue(ioContext, http10, "HTTP/1.0", std::chrono::milliseconds(300)));
+	boost::asio::write(http10, boost::asio::buffer(std::string("abcd")));
+	response.clear();
+	boost::asio::read(http10, boost::asio::dynamic_buffer(response), ec);
+	BOOST_CHECK_EQUAL(0u, response.find("HTTP/1.1 200 "));
+
+	// a handler rejecting the request unread sends its final response only
+	response = testRawRequest("8080", "POST /NoSuchPath HTTP/1.1\r\nContent-Length: 4\r\nExpect: 100-continue\r\n\r\n");
+	BOOST_CHECK_EQUAL(0u, response.find("HTTP/1.1 400 "));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
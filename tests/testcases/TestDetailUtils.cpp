@@ -34,4 +34,91 @@ BOOST_AUTO_TEST_CASE(testDecodePercentEncoding)
 	BOOST_CHECK_EQUAL("\x80\xf0\xff", decoded4);
 }
 
+BOOST_AUTO_TEST_CASE(testWebSocketAcceptKey)
+{
+	// RFC 6455 section 1.3
+	std::string digest = boost_asio_http::detail::utils::sha1("dGhlIHNhbXBsZSBub25jZQ==258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
+	BOOST_CHECK_EQUAL(std::string("s3pPLMBiTxaQ9kYGzzhZRbK+xOo="), boost_asio_http::detail::utils::encode_base64(digest));
+
+	BOOST_CHECK_EQUAL(std::string("Zm9vYg=="), boost_asio_http::detail::utils::encode_base64("foob"));
+	BOOST_CHECK_EQUAL(std::string("Zm9vYmE="), boost_asio_http::detail::utils::encode_base64("fooba"));
+	BOOST_CHECK_EQUAL(std::string("Zm9vYmFy"), boost_asio_http::detail::utils::encode_base64("foobar"));
+}
+
+BOOST_AUTO_TEST_CASE(testApplyMask)
+{
+	const unsigned char key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+	std::string original = "Hello, WebSocket masking in word-sized blocks";
+
+	for (std::size_t size = 0; size <= original.size(); size++) {
+		std::string masked = original.substr(0, size);
+		boost_asio_http::detail::utils::apply_mask(&masked[0], masked.size(), key);
+		for (std::size_t i = 0; i < size; i++) {
+			BOOST_REQUIRE_EQUAL(static_cast<char>(original[i] ^ key[i % 4]), masked[i]);
+		}
+
+		boost_asio_http::detail::utils::apply_mask(&masked[0], masked.size(), key);
+		BOOST_CHECK_EQUAL(original.substr(0, size), masked);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(testIsValidUtf8)
+{
+	auto isValid = [](const std::string& s) { return boost_asio_http::detail::utils::is_valid_utf8(s.data(), s.size()); };
+
+	BOOST_CHECK(isValid(""));
+	BOOST_CHECK(isValid("plain ascii"));
+	BOOST_CHECK(isValid("\xce\xba\xe1\xbd\xb9\xcf\x83\xce\xbc\xce\xb5"));
+	BOOST_CHECK(isValid("\xf4\x8f\xbf\xbf"));
+	BOOST_CHECK(!isValid("\xc0\xaf"));            // overlong
+	BOOST_CHECK(!isValid("\xed\xa0\x80"));        // surrogate
+	BOOST_CHECK(!isValid("\xf4\x90\x80\x80"));    // beyond U+10FFFF
+	BOOST_CHECK(!isValid("\xe1\xbd"));            // truncated
+}
+
+BOOST_AUTO_TEST_CASE(testStatusLine)
+{
+	static_assert(boost_asio_http::detail::status_line(200).size() == 17, "status lines are compile-time constants");
+
+	BOOST_CHECK_EQUAL(std::string("HTTP/1.1 404 Not Found\r\n"), boost_asio_http::detail::status_line(404).to_string());
+	BOOST_CHECK_EQUAL(std::string("Network Authentication Required"), boost_asio_http::detail::reason_phrase(511).to_string());
+	BOOST_CHECK(boost_asio_http::detail::status_line(299).empty());
+}
+
+BOOST_AUTO_TEST_CASE(testHttpDate)
+{
+	// RFC 9110 section 5.6.7
+	char date[29];
+	boost_asio_http::detail::format_http_date(784111777, date);
+	BOOST_CHECK_EQUAL(std::string("Sun, 06 Nov 1994 08:49:37 GMT"), std::string(date, sizeof(date)));
+
+	boost_asio_http::detail::format_http_date(951782400, date);
+	BOOST_CHECK_EQUAL(std::string("Tue, 29 Feb 2000 00:00:00 GMT"), std::string(date, sizeof(date)));
+
+	boost::string_view header = boost_asio_http::detail::date_header();
+	BOOST_CHECK_EQUAL(0u, header.find("Date: "));
+	BOOST_CHECK_EQUAL(37u, header.size());
+}
+
+BOOST_AUTO_TEST_CASE(testMonotonicArena)
+{
+	boost_asio_http::detail::monotonic_arena arena;
+
+	boost::string_view small = arena.copy("small");
+	void* aligned = arena.allocate(8, 8);
+	BOOST_CHECK_EQUAL(std::string("small"), small.to_string());
+	BOOST_CHECK_EQUAL(0u, reinterpret_cast<std::uintptr_t>(aligned) % 8);
+
+	// larger than the inline block, so a heap block is added
+	std::string big(10000, 'x');
+	boost::string_view large = arena.copy(big);
+	BOOST_CHECK_EQUAL(big, large.to_string());
+
+	// after reset both the inline and the added block are handed out again
+	arena.reset();
+	BOOST_CHECK(small.data() == arena.copy("small").data());
+	arena.allocate(8, 8);
+	BOOST_CHECK(large.data() == arena.copy(big).data());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -28,4 +28,35 @@ BOOST_AUTO_TEST_CASE(testPutHandler)
 	BOOST_CHECK_EQUAL(true, check);
 }
 
+BOOST_AUTO_TEST_CASE(testParameterViews)
+{
+	testGet("http://localhost:8080/Parameters?b=2&a=1&c=%41%42&a=3", "./output/TestHandlers_testParameterViews.txt");
+	bool check = compareFiles("./data/parameters_response.txt", "./output/TestHandlers_testParameterViews.txt");
+
+	BOOST_CHECK_EQUAL(true, check);
+}
+
+BOOST_AUTO_TEST_CASE(testCustomHeaders)
+{
+	testGetHeaders("http://localhost:8080/CustomHeaders", "./output/TestHandlers_testCustomHeaders.headers", "./output/TestHandlers_testCustomHeaders.txt", false);
+	std::string headers = readFile("./output/TestHandlers_testCustomHeaders.headers");
+
+	BOOST_CHECK_EQUAL(0u, headers.find("HTTP/1.1 201 Created\r\nDate: "));
+	BOOST_CHECK(headers.find(" GMT\r\nContent-Type: text/plain; charset=utf-8\r\n") != std::string::npos);
+	BOOST_CHECK(headers.find("X-Tag: first\r\nX-Tag: second\r\ncache-control: no-store\r\nX-Rejected: 8\r\n\r\n") != std::string::npos);
+	BOOST_CHECK(headers.find("Connection") == std::string::npos);
+	BOOST_CHECK(headers.find("X-Injected") == std::string::npos);
+	BOOST_CHECK(headers.find("no-cache") == std::string::npos);
+	BOOST_CHECK(headers.find("X-Late") == std::string::npos);
+	BOOST_CHECK_EQUAL(std::string("created, late header refused"), readFile("./output/TestHandlers_testCustomHeaders.txt"));
+}
+
+BOOST_AUTO_TEST_CASE(testUnregisteredStatus)
+{
+	std::string response = testRawRequest("8080", "GET /UnregisteredStatus HTTP/1.1\r\n\r\n");
+
+	BOOST_CHECK_EQUAL(0u, response.find("HTTP/1.1 599 OK\r\n"));
+	BOOST_CHECK(response.find("<title>OK</title>") != std::string::npos);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,305 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../HelperFuncs.h"
+#include "../../boost_asio_http_server.hpp"
+
+BOOST_AUTO_TEST_SUITE(TestHttp2)
+
+static boost_asio_http::detail::header_list decodeHex(boost_asio_http::detail::hpack_decoder& decoder, const std::string& hex)
+{
+	std::vector<unsigned char> block;
+	for (std::size_t i = 0; i + 1 < hex.size(); i += 2) {
+		block.push_back(static_cast<unsigned char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+	}
+
+	boost_asio_http::detail::header_list headers;
+	BOOST_CHECK(decoder.decode(block.data(), block.size(), headers));
+	return headers;
+}
+
+BOOST_AUTO_TEST_CASE(testHpackDecode)
+{
+	// RFC 7541 C.4: requests with Huffman coding sharing one dynamic table
+	boost_asio_http::detail::hpack_decoder decoder;
+
+	auto headers1 = decodeHex(decoder, "828684418cf1e3c2e5f23a6ba0ab90f4ff");
+	BOOST_REQUIRE_EQUAL(4u, headers1.size());
+	BOOST_CHECK_EQUAL(std::string("GET"), headers1[0].second);
+	BOOST_CHECK_EQUAL(std::string(":authority"), headers1[3].first);
+	BOOST_CHECK_EQUAL(std::string("www.example.com"), headers1[3].second);
+
+	auto headers2 = decodeHex(decoder, "828684be5886a8eb10649cbf");
+	BOOST_REQUIRE_EQUAL(5u, headers2.size());
+	BOOST_CHECK_EQUAL(std::string("www.example.com"), headers2[3].second);
+	BOOST_CHECK_EQUAL(std::string("no-cache"), headers2[4].second);
+
+	auto headers3 = decodeHex(decoder, "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf");
+	BOOST_REQUIRE_EQUAL(5u, headers3.size());
+	BOOST_CHECK_EQUAL(std::string("https"), headers3[1].second);
+	BOOST_CHECK_EQUAL(std::string("/index.html"), headers3[2].second);
+	BOOST_CHECK_EQUAL(std::string("custom-key"), headers3[4].first);
+	BOOST_CHECK_EQUAL(std::string("custom-value"), headers3[4].second);
+}
+
+BOOST_AUTO_TEST_CASE(testHpackEncodeIndexing)
+{
+	boost_asio_http::detail::hpack_encoder encoder;
+	boost_asio_http::detail::hpack_decoder decoder;
+	boost_asio_http::detail::header_list headers = { {":status", "200"}, {"content-type", "text/html"}, {"content-length", "97"} };
+
+	std::string block1, block2;
+	encoder.encode(headers, block1);
+	encoder.encode(headers, block2);
+	BOOST_CHECK_LT(block2.size(), block1.size());
+
+	boost_asio_http::detail::header_list decoded1, decoded2;
+	BOOST_CHECK(decoder.decode(reinterpret_cast<const unsigned char*>(block1.data()), block1.size(), decoded1));
+	BOOST_CHECK(decoder.decode(reinterpret_cast<const unsigned char*>(block2.data()), block2.size(), decoded2));
+	BOOST_CHECK(headers == decoded1);
+	BOOST_CHECK(headers == decoded2);
+}
+
+BOOST_AUTO_TEST_CASE(testPriorKnowledgeGet)
+{
+	testGetHttp2("http://localhost:8080/", "./output/TestHttp2_testPriorKnowledgeGet.html", true);
+	bool check = compareFiles("./data/index.html", "./output/TestHttp2_testPriorKnowledgeGet.html");
+
+	BOOST_CHECK_EQUAL(true, check);
+}
+
+BOOST_AUTO_TEST_CASE(testUpgradeGetHandler)
+{
+	testGetHttp2("http://localhost:8080/Hello?greeting=Hello", "./output/TestHttp2_testUpgradeGetHandler.html", false);
+	bool check = compareFiles("./data/hello.html", "./output/TestHttp2_testUpgradeGetHandler.html");
+
+	BOOST_CHECK_EQUAL(true, check);
+}
+
+BOOST_AUTO_TEST_CASE(testPriorKnowledgePutHandler)
+{
+	testPutHttp2("http://localhost:8080/PutToNull", "./data/20k.txt", "./output/TestHttp2_testPriorKnowledgePutHandler.txt");
+	bool check = compareFiles("./data/put_to_null_response.txt", "./output/TestHttp2_testPriorKnowledgePutHandler.txt");
+
+	BOOST_CHECK_EQUAL(true, check);
+}
+
+BOOST_AUTO_TEST_CASE(testMultiplexedGetHandler)
+{
+	std::vector<std::string> uris, outPaths;
+	for (int i = 0; i < 10; i++) {
+		uris.push_back("http://localhost:8080/Hello?greeting=Hello");
+		outPaths.push_back("./output/TestHttp2_testMultiplexedGetHandler" + std::to_string(i) + ".html");
+	}
+	testGetHttp2Parallel(uris, outPaths);
+
+	for (auto& outPath : outPaths) {
+		BOOST_CHECK_EQUAL(true, compareFiles("./data/hello.html", outPath));
+	}
+}
+
+// Minimal h2c client speaking raw frames, so that the test controls when each stream's data is sent.
+class RawHttp2Client
+{
+public:
+	RawHttp2Client()
+		: socket_(ioContext_)
+	{
+		socket_.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 8080));
+		std::string preface("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n");
+		boost::asio::write(socket_, boost::asio::buffer(preface));
+		send(4, 0, 0, "");
+	}
+
+	void send(unsigned char type, unsigned char flags, std::uint32_t id, const std::string& payload)
+	{
+		std::string frame;
+		frame.push_back(static_cast<char>(payload.size() >> 16));
+		frame.push_back(static_cast<char>(payload.size() >> 8));
+		frame.push_back(static_cast<char>(payload.size()));
+		frame.push_back(static_cast<char>(type));
+		frame.push_back(static_cast<char>(flags));
+		for (int shift = 24; shift >= 0; shift -= 8) frame.push_back(static_cast<char>(id >> shift));
+		boost::asio::write(socket_, boost::asio::buffer(frame + payload));
+	}
+
+	void send_headers(std::uint32_t id, const boost_asio_http::detail::header_list& headers, bool endStream)
+	{
+		std::string block;
+		encoder_.encode(headers, block);
+		send(1, endStream ? 0x5 : 0x4, id, block);
+	}
+
+	// Reads frames until 'id' has ended, recording the order in which streams end; false on timeout.
+	bool read_until_closed(std::uint32_t id)
+	{
+		while (std::find(closed_.begin(), closed_.end(), id) == closed_.end()) {
+			unsigned char header[9];
+			if (!read_exact(header, sizeof(header))) return false;
+			std::size_t length = (header[0] << 16) | (header[1] << 8) | header[2];
+			std::uint32_t stream = ((header[5] & 0x7f) << 24) | (header[6] << 16) | (header[7] << 8) | header[8];
+			std::string payload(length, '\0');
+			if (length > 0 && !read_exact(&payload[0], length)) return false;
+
+			if (header[3] == 4 && !(header[4] & 0x1)) {
+				for (std::size_t i = 0; i + 6 <= length; i += 6) settings_[(payload[i] << 8) | static_cast<unsigned char>(payload[i + 1])] = code(payload, i + 2);
+				send(4, 0x1, 0, "");
+			}
+			if (header[3] == 7) {
+				goawayError_ = code(payload, 4);
+				return false;
+			}
+			if (stream == 0) continue;
+			if (header[3] == 3) {
+				resets_[stream] = code(payload, 0);
+				closed_.push_back(stream);
+			}
+			if (header[3] == 0) bodies_[stream] += payload;
+			if ((header[3] == 0 || header[3] == 1) && (header[4] & 0x1)) closed_.push_back(stream);
+		}
+		return true;
+	}
+
+	std::vector<std::uint32_t> closed_;
+	std::map<std::uint32_t, std::string> bodies_;
+	std::uint32_t goawayError_ = 0xffffffff;
+	std::map<std::uint32_t, std::uint32_t> resets_, settings_;
+
+private:
+	static std::uint32_t code(const std::string& payload, std::size_t offset)
+	{
+		std::uint32_t value = 0;
+		for (std::size_t i = offset; i < offset + 4; i++) value = (value << 8) | static_cast<unsigned char>(payload[i]);
+		return value;
+	}
+
+	bool read_exact(void* data, std::size_t size)
+	{
+		boost::system::error_code ec = boost::asio::error::timed_out;
+		boost::asio::async_read(socket_, boost::asio::buffer(data, size), [&ec](const boost::system::error_code& e, std::size_t) { ec = e; });
+		ioContext_.restart();
+		ioContext_.run_for(std::chrono::seconds(5));
+		if (!ioContext_.stopped()) {
+			socket_.cancel();
+			ioContext_.run();
+		}
+		return !ec;
+	}
+
+	boost::asio::io_context ioContext_;
+	boost::asio::ip::tcp::socket socket_;
+	boost_asio_http::detail::hpack_encoder encoder_;
+};
+
+BOOST_AUTO_TEST_CASE(testInterleavedStreams)
+{
+	RawHttp2Client client;
+	boost_asio_http::detail::header_list put = { {":method", "PUT"}, {":scheme", "http"}, {":authority", "localhost"}, {":path", "/PutToNull"}, {"content-length", "4"} };
+	boost_asio_http::detail::header_list get = { {":method", "GET"}, {":scheme", "http"}, {":authority", "localhost"}, {":path", "/Hello?greeting=Hello"} };
+
+	// all three streams are opened before anything is read; stream 1 holds back its body
+	client.send_headers(1, put, false);
+	client.send_headers(3, get, true);
+	client.send_headers(5, get, true);
+
+	BOOST_REQUIRE(client.read_until_closed(3));
+	BOOST_REQUIRE(client.read_until_closed(5));
+	BOOST_CHECK(client.bodies_.find(1) == client.bodies_.end());
+
+	client.send(0, 0x1, 1, "abcd");
+	BOOST_REQUIRE(client.read_until_closed(1));
+
+	std::vector<std::uint32_t> expected = { 3, 5, 1 };
+	BOOST_CHECK(expected == client.closed_);
+	BOOST_CHECK_EQUAL(std::string("4"), client.bodies_[1]);
+	BOOST_CHECK_EQUAL(readFile("./data/hello.html"), client.bodies_[3]);
+	BOOST_CHECK_EQUAL(client.bodies_[3], client.bodies_[5]);
+}
+
+BOOST_AUTO_TEST_CASE(testContinuationOnOtherStream)
+{
+	RawHttp2Client client;
+	boost_asio_http::detail::header_list get = { {":method", "GET"}, {":scheme", "http"}, {":authority", "localhost"}, {":path", "/Hello?greeting=Hello"} };
+
+	// a header block left open on stream 1 and continued on stream 3
+	std::string block;
+	boost_asio_http::detail::hpack_encoder encoder;
+	encoder.encode(get, block);
+	client.send(1, 0x1, 1, block.substr(0, 2));
+	client.send(9, 0x4, 3, block.substr(2));
+
+	BOOST_CHECK(!client.read_until_closed(1));
+	BOOST_CHECK_EQUAL(1u, client.goawayError_);
+}
+
+BOOST_AUTO_TEST_CASE(testHeaderBlockTooLarge)
+{
+	RawHttp2Client client;
+	boost_asio_http::detail::header_list get = { {":method", "GET"}, {":scheme", "http"}, {":authority", "localhost"}, {":path", "/Hello?greeting=Hello"} };
+
+	std::string block;
+	boost_asio_http::detail::hpack_encoder encoder;
+	encoder.encode(get, block);
+	client.send(1, 0x1, 1, block);
+	for (int i = 0; i < 2; i++) client.send(9, 0, 1, std::string(8 * 1024, '\0'));
+
+	BOOST_CHECK(!client.read_until_closed(1));
+	BOOST_CHECK_EQUAL(16u * 1024, client.settings_[6]);    // SETTINGS_MAX_HEADER_LIST_SIZE
+	BOOST_CHECK_EQUAL(11u, client.goawayError_);            // ENHANCE_YOUR_CALM
+}
+
+BOOST_AUTO_TEST_CASE(testHeaderListTooLarge)
+{
+	RawHttp2Client client;
+	boost_asio_http::detail::header_list get = { {":method", "GET"}, {":scheme", "http"}, {":authority", "localhost"}, {":path", "/Hello?greeting=Hello"} };
+
+	// a small block whose repeated indexed field decodes beyond the limit only resets its stream
+	boost_asio_http::detail::header_list large = get;
+	for (int i = 0; i < 8; i++) large.emplace_back("x-large", std::string(3000, 'x'));
+	client.send_headers(1, large, true);
+	BOOST_REQUIRE(client.read_until_closed(1));
+	BOOST_CHECK_EQUAL(11u, client.resets_[1]);
+
+	client.send_headers(3, get, true);
+	BOOST_REQUIRE(client.read_until_closed(3));
+	BOOST_CHECK_EQUAL(readFile("./data/hello.html"), client.bodies_[3]);
+}
+
+BOOST_AUTO_TEST_CASE(testHeadersOnClosedStream)
+{
+	RawHttp2Client client;
+	boost_asio_http::detail::header_list get = { {":method", "GET"}, {":scheme", "http"}, {":authority", "localhost"}, {":path", "/Hello?greeting=Hello"} };
+
+	client.send_headers(3, get, true);
+	BOOST_REQUIRE(client.read_until_closed(3));
+	client.send_headers(1, get, true);      // below the last stream, so implicitly closed
+
+	BOOST_CHECK(!client.read_until_closed(1));
+	BOOST_CHECK_EQUAL(5u, client.goawayError_);     // STREAM_CLOSED
+}
+
+BOOST_AUTO_TEST_CASE(testInitialWindowOverflow)
+{
+	RawHttp2Client client;
+	boost_asio_http::detail::header_list put = { {":method", "PUT"}, {":scheme", "http"}, {":authority", "localhost"}, {":path", "/PutToNull"}, {"content-length", "4"} };
+
+	client.send_headers(1, put, false);
+	client.send(8, 0, 1, std::string("\x00\x00\x10\x00", 4));     // the stream's window grows by 4096
+	client.send(4, 0, 0, std::string("\x00\x04\x7f\xff\xff\xff", 6));  // and then by 2^31-1 - 65535
+
+	BOOST_CHECK(!client.read_until_closed(1));
+	BOOST_CHECK_EQUAL(3u, client.goawayError_);     // FLOW_CONTROL_ERROR
+}
+
+BOOST_AUTO_TEST_CASE(testCustomHeaders)
+{
+	testGetHeaders("http://localhost:8080/CustomHeaders", "./output/TestHttp2_testCustomHeaders.headers", "./output/TestHttp2_testCustomHeaders.txt", true);
+	std::string headers = readFile("./output/TestHttp2_testCustomHeaders.headers");
+
+	BOOST_CHECK_EQUAL(0u, headers.find("HTTP/2 201"));
+	BOOST_CHECK(headers.find("\r\ndate: ") != std::string::npos);
+	BOOST_CHECK(headers.find("\r\nx-tag: first\r\nx-tag: second\r\ncache-control: no-store\r\n") != std::string::npos);
+	BOOST_CHECK(headers.find("connection") == std::string::npos);
+	BOOST_CHECK_EQUAL(std::string("created, late header refused"), readFile("./output/TestHttp2_testCustomHeaders.txt"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,82 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../HelperFuncs.h"
+#include "../../boost_asio_http_server.hpp"
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+BOOST_AUTO_TEST_SUITE(TestLocalSocket)
+
+BOOST_AUTO_TEST_CASE(testSocketFile)
+{
+	boost::filesystem::file_status status = boost::filesystem::status("./test.sock");
+
+	BOOST_CHECK_EQUAL(boost::filesystem::socket_file, status.type());
+	BOOST_CHECK_EQUAL(boost::filesystem::owner_read | boost::filesystem::owner_write | boost::filesystem::group_read | boost::filesystem::group_write, status.permissions());
+}
+
+BOOST_AUTO_TEST_CASE(testGetFile)
+{
+	testGetUnixSocket("./test.sock", "http://localhost/", "./output/TestLocalSocket_testGetFile.html");
+	bool check = compareFiles("./data/index.html", "./output/TestLocalSocket_testGetFile.html");
+
+	BOOST_CHECK_EQUAL(true, check);
+}
+
+BOOST_AUTO_TEST_CASE(testGetHandler)
+{
+	testGetUnixSocket("./test.sock", "http://localhost/Hello?greeting=Hello", "./output/TestLocalSocket_testGetHandler.html");
+	bool check = compareFiles("./data/hello.html", "./output/TestLocalSocket_testGetHandler.html");
+
+	BOOST_CHECK_EQUAL(true, check);
+}
+
+BOOST_AUTO_TEST_CASE(testPutHandler)
+{
+	testPutUnixSocket("./test.sock", "http://localhost/PutToNull", "./data/20k.txt", "./output/TestLocalSocket_testPutHandler.txt");
+	bool check = compareFiles("./data/put_to_null_response.txt", "./output/TestLocalSocket_testPutHandler.txt");
+
+	BOOST_CHECK_EQUAL(true, check);
+}
+
+BOOST_AUTO_TEST_CASE(testSocketInUse)
+{
+	boost_asio_http::server server("./doc");
+
+	BOOST_CHECK(!server.listen_local("./test.sock"));
+	BOOST_CHECK_EQUAL(boost::filesystem::socket_file, boost::filesystem::status("./test.sock").type());
+	testGetUnixSocket("./test.sock", "http://localhost/Hello?greeting=Hello", "./output/TestLocalSocket_testSocketInUse.html");
+	BOOST_CHECK_EQUAL(true, compareFiles("./data/hello.html", "./output/TestLocalSocket_testSocketInUse.html"));
+}
+
+BOOST_AUTO_TEST_CASE(testStaleSocketFile)
+{
+	// a closed acceptor leaves its socket file behind, as a crashed process would
+	{
+		boost::asio::io_context ioContext;
+		boost::asio::local::stream_protocol::acceptor stale(ioContext, boost::asio::local::stream_protocol::endpoint("./stale.sock"));
+	}
+	BOOST_REQUIRE_EQUAL(boost::filesystem::socket_file, boost::filesystem::status("./stale.sock").type());
+
+	boost_asio_http::server server("./doc");
+	BOOST_CHECK(server.listen_local("./stale.sock"));
+	BOOST_CHECK(!server.listen_local("./stale.sock"));
+	BOOST_CHECK(server.is_listening_local());
+	boost::filesystem::remove("./stale.sock");
+}
+
+BOOST_AUTO_TEST_CASE(testValidityKeptApart)
+{
+	// the TCP port is taken by the test server
+	boost_asio_http::server server("127.0.0.1", "8080", "./doc");
+	BOOST_CHECK(!server.is_listening_local());
+	BOOST_CHECK(server.listen_local("./apart.sock"));
+
+	BOOST_CHECK(!server.is_valid());
+	BOOST_CHECK(server.is_listening_local());
+	boost::filesystem::remove("./apart.sock");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
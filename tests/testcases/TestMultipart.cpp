@@ -0,0 +1,128 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../HelperFuncs.h"
+#include "../../boost_asio_http_server.hpp"
+
+BOOST_AUTO_TEST_SUITE(TestMultipart)
+
+// Delivers the body a few bytes at a time, as a slow connection would.
+class TrickleBuffer : public std::streambuf
+{
+public:
+	TrickleBuffer(const std::string& data, std::size_t chunk) : data_(data), chunk_(chunk), pos_(0) {}
+
+protected:
+	int underflow() override
+	{
+		if (pos_ >= data_.size()) return traits_type::eof();
+
+		std::size_t n = std::min(chunk_, data_.size() - pos_);
+		char* p = &data_[pos_];
+		setg(p, p, p + n);
+		pos_ += n;
+		return traits_type::to_int_type(*p);
+	}
+
+private:
+	std::string data_;
+	std::size_t chunk_;
+	std::size_t pos_;
+};
+
+static const std::string contentType = "multipart/form-data; boundary=----xyz";
+
+static std::string makeBody(const std::string& file)
+{
+	return "preamble\r\n"
+	       "------xyz\r\n"
+	       "Content-Disposition: form-data; name=\"name\"\r\n"
+	       "\r\n"
+	       "taro\r\n"
+	       "------xyz  \r\n"
+	       "Content-Disposition: form-data; name=\"file\"; filename=\"data.bin\"\r\n"
+	       "Content-Type: application/octet-stream\r\n"
+	       "\r\n"
+	       + file + "\r\n"
+	       "------xyz--\r\n"
+	       "epilogue";
+}
+
+BOOST_AUTO_TEST_CASE(testHorspoolSearcher)
+{
+	boost_asio_http::detail::horspool_searcher searcher("\r\n--ab");
+	std::string text = "xx\r\n-\r\n--a\r\n--ab\r\n--ab";
+
+	BOOST_CHECK_EQUAL(10u, searcher.search(text.data(), text.data() + text.size()));
+	BOOST_CHECK_EQUAL(std::string::npos, searcher.search(text.data(), text.data() + 15));
+}
+
+BOOST_AUTO_TEST_CASE(testReadParts)
+{
+	// near misses of the delimiter inside the content
+	std::string file = "\r\n------xy\r\n----xyz\r\n";
+	for (int i = 0; i < 5000; i++) file.push_back(static_cast<char>(i * 7));
+
+	for (std::size_t chunk : { 1, 3, 7, 64, 100000 }) {
+		TrickleBuffer buffer(makeBody(file), chunk);
+		std::istream body(&buffer);
+		boost_asio_http::multipart_reader parts(body, contentType);
+
+		BOOST_REQUIRE(parts.next());
+		BOOST_CHECK_EQUAL(std::string("name"), parts.name());
+		BOOST_CHECK_EQUAL(std::string(""), parts.filename());
+		BOOST_CHECK_EQUAL(std::string("text/plain"), parts.content_type());
+		std::stringstream name;
+		name << parts.stream().rdbuf();
+		BOOST_CHECK_EQUAL(std::string("taro"), name.str());
+
+		BOOST_REQUIRE(parts.next());
+		BOOST_CHECK_EQUAL(std::string("file"), parts.name());
+		BOOST_CHECK_EQUAL(std::string("data.bin"), parts.filename());
+		BOOST_CHECK_EQUAL(std::string("application/octet-stream"), parts.header("CONTENT-TYPE"));
+		std::stringstream data;
+		data << parts.stream().rdbuf();
+		BOOST_CHECK(file == data.str());
+
+		BOOST_CHECK(!parts.next());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(testSkipParts)
+{
+	TrickleBuffer buffer(makeBody("unread"), 5);
+	std::istream body(&buffer);
+	boost_asio_http::multipart_reader parts(body, contentType);
+
+	BOOST_CHECK(parts.next());
+	BOOST_CHECK(parts.next());
+	BOOST_CHECK_EQUAL(std::string("file"), parts.name());
+	BOOST_CHECK(!parts.next());
+}
+
+BOOST_AUTO_TEST_CASE(testMalformed)
+{
+	std::string truncated = makeBody("content");
+	truncated = truncated.substr(0, truncated.find("content"));
+
+	TrickleBuffer buffer(truncated, 4);
+	std::istream body(&buffer);
+	boost_asio_http::multipart_reader parts(body, contentType);
+
+	BOOST_CHECK(parts.next());
+	BOOST_CHECK(parts.next());
+	BOOST_CHECK(!parts.next());
+
+	std::istringstream plain("name=taro");
+	boost_asio_http::multipart_reader notMultipart(plain, "application/x-www-form-urlencoded");
+	BOOST_CHECK(!notMultipart.next());
+}
+
+BOOST_AUTO_TEST_CASE(testUploadHandler)
+{
+	testPostMultipart("http://localhost:8080/Upload", { "name=taro", "file=@./data/20k.txt" }, "./output/TestMultipart_testUploadHandler.txt");
+	bool check = compareFiles("./data/upload_response.txt", "./output/TestMultipart_testUploadHandler.txt");
+
+	BOOST_CHECK_EQUAL(true, check);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,189 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../HelperFuncs.h"
+#include "../../boost_asio_http_server.hpp"
+
+#include <atomic>
+#include <thread>
+
+// Cached routes on a server of its own, so that every test starts with empty caches.
+class CacheServer
+{
+public:
+	CacheServer()
+		: server_("0.0.0.0", "8081", "./doc")
+	{
+		server_.set_get_handler("/Counter", counter(calls_), std::chrono::milliseconds(2000));
+		server_.set_get_handler("/Expiring", counter(calls_), std::chrono::milliseconds(200));
+		server_.set_get_handler("/Private", counter(calls_, "Cache-Control", "private"), std::chrono::milliseconds(2000));
+		server_.set_get_handler("/VaryEncoding", counter(calls_, "Vary", "Accept-Encoding"), std::chrono::milliseconds(2000));
+		server_.set_get_handler("/VaryAgent", counter(calls_, "Vary", "Accept, User-Agent"), std::chrono::milliseconds(2000));
+		server_.set_get_handler("/Small", counter(calls_), std::chrono::milliseconds(2000), 2);
+		server_.set_get_handler("/StackDepth", stackDepth, std::chrono::milliseconds(2000));
+
+		thread_ = std::thread(&boost_asio_http::server::run, &server_);
+	}
+
+	~CacheServer()
+	{
+		server_.stop();
+		thread_.join();
+	}
+
+	std::atomic<int> calls_{0};
+
+private:
+	// The request body is read first, so a client that holds it back keeps the handler suspended.
+	static boost_asio_http::handler counter(std::atomic<int>& calls, const std::string& name = "", const std::string& value = "")
+	{
+		return [&calls, name, value](boost_asio_http::request& rq, boost_asio_http::response& rs) {
+			std::string body(static_cast<std::size_t>(rq.content_length()), '\0');
+			rq.stream().read(&body[0], body.size());
+
+			rs.set_code(boost_asio_http::response::ok);
+			rs.set_content_type("text/plain");
+			if (!name.empty()) rs.set_header(name, value);
+			rs.stream() << ++calls;
+		};
+	}
+
+	// Bytes of coroutine stack between the connection's streambuf and the handler's frame.
+	static void stackDepth(boost_asio_http::request& rq, boost_asio_http::response& rs)
+	{
+		char local = 0;
+		std::uintptr_t here = reinterpret_cast<std::uintptr_t>(&local);
+		std::uintptr_t connection = reinterpret_cast<std::uintptr_t>(rq.stream().rdbuf());
+
+		rs.set_code(boost_asio_http::response::ok);
+		rs.set_content_type("text/plain");
+		rs.stream() << (connection > here ? connection - here : here - connection);
+	}
+
+	boost_asio_http::server server_;
+	std::thread thread_;
+};
+
+static std::string get(const std::string& uri, const std::string& outPath)
+{
+	testGet(uri, outPath);
+	return readFile(outPath);
+}
+
+static std::string readBody(boost::asio::ip::tcp::socket& socket)
+{
+	boost::system::error_code ec;
+	std::string response;
+	boost::asio::read(socket, boost::asio::dynamic_buffer(response), ec);
+	return response.substr(response.find("\r\n\r\n") + 4);
+}
+
+static std::string getWith(const std::string& target, const std::string& headers)
+{
+	std::string response = testRawRequest("8081", "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n");
+	return response.substr(response.find("\r\n\r\n") + 4);
+}
+
+BOOST_FIXTURE_TEST_SUITE(TestResponseCache, CacheServer)
+
+BOOST_AUTO_TEST_CASE(testNormalizedKey)
+{
+	std::string first = get("http://localhost:8081/Counter?a=1&b=2", "./output/TestResponseCache_testNormalizedKey1.txt");
+	std::string reordered = get("http://localhost:8081/Counter?b=2&a=%31", "./output/TestResponseCache_testNormalizedKey2.txt");
+	std::string other = get("http://localhost:8081/Counter?a=1&b=3", "./output/TestResponseCache_testNormalizedKey3.txt");
+
+	BOOST_CHECK_EQUAL(std::string("1"), first);
+	BOOST_CHECK_EQUAL(first, reordered);
+	BOOST_CHECK_EQUAL(std::string("2"), other);
+	BOOST_CHECK_EQUAL(2, calls_.load());
+}
+
+BOOST_AUTO_TEST_CASE(testExpiry)
+{
+	std::string first = get("http://localhost:8081/Expiring", "./output/TestResponseCache_testExpiry1.txt");
+	std::string hit = get("http://localhost:8081/Expiring", "./output/TestResponseCache_testExpiry2.txt");
+	std::this_thread::sleep_for(std::chrono::milliseconds(400));
+	std::string expired = get("http://localhost:8081/Expiring", "./output/TestResponseCache_testExpiry3.txt");
+
+	BOOST_CHECK_EQUAL(first, hit);
+	BOOST_CHECK_EQUAL(std::string("2"), expired);
+}
+
+BOOST_AUTO_TEST_CASE(testCollapsedMisses)
+{
+	boost::asio::io_context ioContext;
+	boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::make_address("127.0.0.1"), 8081);
+
+	// the first request leaves its handler waiting for a body
+	boost::asio::ip::tcp::socket first(ioContext);
+	first.connect(endpoint);
+	boost::asio::write(first, boost::asio::buffer(std::string("GET /Counter?id=7 HTTP/1.1\r\nContent-Length: 4\r\n\r\n")));
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	std::vector<std::unique_ptr<boost::asio::ip::tcp::socket>> others;
+	for (int i = 0; i < 3; i++) {
+		others.emplace_back(new boost::asio::ip::tcp::socket(ioContext));
+		others.back()->connect(endpoint);
+		boost::asio::write(*others.back(), boost::asio::buffer(std::string("GET /Counter?id=7 HTTP/1.1\r\n\r\n")));
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	BOOST_CHECK_EQUAL(0, calls_.load());
+
+	boost::asio::write(first, boost::asio::buffer(std::string("body")));
+	BOOST_CHECK_EQUAL(std::string("1"), readBody(first));
+	for (auto& socket : others) {
+		BOOST_CHECK_EQUAL(std::string("1"), readBody(*socket));
+	}
+	BOOST_CHECK_EQUAL(1, calls_.load());
+}
+
+BOOST_AUTO_TEST_CASE(testPrivateNotStored)
+{
+	std::string first = get("http://localhost:8081/Private", "./output/TestResponseCache_testPrivateNotStored1.txt");
+	std::string second = get("http://localhost:8081/Private", "./output/TestResponseCache_testPrivateNotStored2.txt");
+
+	BOOST_CHECK_EQUAL(std::string("1"), first);
+	BOOST_CHECK_EQUAL(std::string("2"), second);
+}
+
+BOOST_AUTO_TEST_CASE(testCredentialsBypass)
+{
+	BOOST_CHECK_EQUAL(std::string("1"), getWith("/Counter", ""));
+	BOOST_CHECK_EQUAL(std::string("2"), getWith("/Counter", "Authorization: Bearer alice\r\n"));
+	BOOST_CHECK_EQUAL(std::string("3"), getWith("/Counter", "Authorization: Bearer alice\r\n"));
+	BOOST_CHECK_EQUAL(std::string("4"), getWith("/Counter", "Cookie: session=bob\r\n"));
+	BOOST_CHECK_EQUAL(std::string("1"), getWith("/Counter", ""));
+}
+
+BOOST_AUTO_TEST_CASE(testAcceptHeadersInKey)
+{
+	BOOST_CHECK_EQUAL(std::string("1"), getWith("/VaryEncoding", "Accept-Encoding: gzip\r\n"));
+	BOOST_CHECK_EQUAL(std::string("2"), getWith("/VaryEncoding", ""));
+	BOOST_CHECK_EQUAL(std::string("1"), getWith("/VaryEncoding", "Accept-Encoding: gzip\r\n"));
+	BOOST_CHECK_EQUAL(std::string("3"), getWith("/VaryEncoding", "Accept-Encoding: gzip\r\nAccept: text/plain\r\n"));
+
+	// the key has no User-Agent, so such a response is not stored
+	BOOST_CHECK_EQUAL(std::string("4"), getWith("/VaryAgent", "User-Agent: a\r\n"));
+	BOOST_CHECK_EQUAL(std::string("5"), getWith("/VaryAgent", "User-Agent: a\r\n"));
+}
+
+BOOST_AUTO_TEST_CASE(testMaxEntries)
+{
+	BOOST_CHECK_EQUAL(std::string("1"), getWith("/Small?id=1", ""));
+	BOOST_CHECK_EQUAL(std::string("2"), getWith("/Small?id=2", ""));
+	BOOST_CHECK_EQUAL(std::string("1"), getWith("/Small?id=1", ""));
+
+	// the oldest entry makes room
+	BOOST_CHECK_EQUAL(std::string("3"), getWith("/Small?id=3", ""));
+	BOOST_CHECK_EQUAL(std::string("4"), getWith("/Small?id=1", ""));
+	BOOST_CHECK_EQUAL(std::string("3"), getWith("/Small?id=3", ""));
+	BOOST_CHECK_EQUAL(std::string("4"), getWith("/Small?id=1", ""));
+}
+
+BOOST_AUTO_TEST_CASE(testSmallCoroutineStack)
+{
+	// connection coroutines may get as little as 64 KiB of stack, so the cache must not add buffers to it
+	std::size_t depth = std::stoul(getWith("/StackDepth", ""));
+	BOOST_CHECK_LT(depth, 16u * 1024);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,91 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../../boost_asio_http_server.hpp"
+
+#if defined(BOOST_ASIO_HTTP_USE_SSL)
+
+#include "../SelfSignedCert.h"
+
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(TestSsl)
+
+// GET / on a new connection, offering 'session' for resumption; 'session' is replaced by the one the server issued.
+static bool connectOnce(boost::asio::ssl::context& clientContext, SSL_SESSION*& session)
+{
+	boost::asio::io_context ioContext;
+	boost::asio::ssl::stream<boost::asio::ip::tcp::socket> stream(ioContext, clientContext);
+	stream.lowest_layer().connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 8443));
+	if (session) SSL_set_session(stream.native_handle(), session);
+	stream.handshake(boost::asio::ssl::stream_base::client);
+
+	boost::asio::write(stream, boost::asio::buffer(std::string("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+	boost::system::error_code ec;
+	std::array<char, 1024> buffer;
+	while (!ec) stream.read_some(boost::asio::buffer(buffer), ec);
+
+	bool reused = SSL_session_reused(stream.native_handle()) == 1;
+	if (session) SSL_SESSION_free(session);
+	session = SSL_get1_session(stream.native_handle());
+
+	stream.shutdown(ec);    // an SSL freed without close_notify marks its session as not resumable
+	return reused;
+}
+
+BOOST_AUTO_TEST_CASE(testTicketKeyRotation)
+{
+	boost_asio_http::detail::session_ticket_keys keys(std::chrono::seconds(1));
+	boost_asio_http::detail::session_ticket_keys::key first = keys.current(), found;
+	bool renew = false;
+
+	BOOST_CHECK(keys.find(first.name, found, renew));
+	BOOST_CHECK(!renew);
+
+	// after one rotation the old key still decrypts, and its tickets are renewed
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+	BOOST_CHECK(std::memcmp(first.name, keys.current().name, sizeof(first.name)) != 0);
+	BOOST_CHECK(keys.find(first.name, found, renew));
+	BOOST_CHECK(renew);
+
+	// after the next one it is gone
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+	BOOST_CHECK(!keys.find(first.name, found, renew));
+}
+
+BOOST_AUTO_TEST_CASE(testTicketResumption)
+{
+	std::string certPem, keyPem;
+	makeSelfSigned(certPem, keyPem);
+
+	boost_asio_http::ssl_context context;
+	context.native().use_certificate_chain(boost::asio::buffer(certPem));
+	context.native().use_private_key(boost::asio::buffer(keyPem), boost::asio::ssl::context::pem);
+	context.enable_session_tickets(std::chrono::seconds(1));
+
+	boost_asio_http::ssl_server server("127.0.0.1", "8443", "./doc", context);
+	BOOST_REQUIRE(server.is_valid());
+	std::thread thread(&boost_asio_http::ssl_server::run, &server);
+
+	boost::asio::ssl::context clientContext(boost::asio::ssl::context::tls_client);
+	clientContext.set_verify_mode(boost::asio::ssl::verify_none);
+	SSL_CTX_set_session_cache_mode(clientContext.native_handle(), SSL_SESS_CACHE_CLIENT);
+
+	SSL_SESSION* session = nullptr;
+	BOOST_CHECK(!connectOnce(clientContext, session));
+
+	// the ticket was sealed with the key that is now the previous one
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+	BOOST_CHECK(connectOnce(clientContext, session));
+
+	// the renewed ticket's key has been rotated out twice
+	std::this_thread::sleep_for(std::chrono::milliseconds(2200));
+	BOOST_CHECK(!connectOnce(clientContext, session));
+
+	SSL_SESSION_free(session);
+	server.stop();
+	thread.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -0,0 +1,259 @@
+#include <boost/test/unit_test.hpp>
+
+#include "../../boost_asio_http_server.hpp"
+
+BOOST_AUTO_TEST_SUITE(TestWebSocket)
+
+// Minimal client: handshake, masked frames and raw frame reading.
+class WebSocketClient
+{
+public:
+	WebSocketClient() : socket_(ioContext_) {}
+
+	std::string connect(const std::string& path, const std::string& extraHeaders = "")
+	{
+		boost::asio::ip::tcp::resolver resolver(ioContext_);
+		boost::asio::connect(socket_, resolver.resolve("localhost", "8080"));
+
+		std::string rq = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+		                 "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n" + extraHeaders + "\r\n";
+		boost::asio::write(socket_, boost::asio::buffer(rq));
+
+		boost::asio::read_until(socket_, buffer_, "\r\n\r\n");
+		std::string header(boost::asio::buffers_begin(buffer_.data()), boost::asio::buffers_end(buffer_.data()));
+		header = header.substr(0, header.find("\r\n\r\n") + 4);
+		buffer_.consume(header.size());
+		return header;
+	}
+
+	void sendFrame(int opcode, const std::string& payload, bool fin = true, bool rsv1 = false)
+	{
+		const unsigned char key[4] = { 0x12, 0x34, 0x56, 0x78 };
+		std::string frame;
+		frame.push_back(static_cast<char>((fin ? 0x80 : 0) | (rsv1 ? 0x40 : 0) | opcode));
+		if (payload.size() < 126) {
+			frame.push_back(static_cast<char>(0x80 | payload.size()));
+		} else {
+			frame.push_back(static_cast<char>(0x80 | 126));
+			frame.push_back(static_cast<char>(payload.size() >> 8));
+			frame.push_back(static_cast<char>(payload.size() & 0xff));
+		}
+		frame.append(reinterpret_cast<const char*>(key), sizeof(key));
+		for (std::size_t i = 0; i < payload.size(); i++) frame.push_back(payload[i] ^ key[i % 4]);
+
+		boost::asio::write(socket_, boost::asio::buffer(frame));
+	}
+
+	int readFrame(std::string& payload, bool* rsv1 = nullptr)
+	{
+		unsigned char header[2];
+		read(header, sizeof(header));
+		if (rsv1) *rsv1 = (header[0] & 0x40) != 0;
+
+		std::size_t length = header[1] & 0x7f;
+		if (length == 126) {
+			unsigned char extended[2];
+			read(extended, sizeof(extended));
+			length = (extended[0] << 8) | extended[1];
+		}
+		payload.resize(length);
+		if (length > 0) read(&payload[0], length);
+		return header[0] & 0x0f;
+	}
+
+private:
+	void read(void* data, std::size_t size)
+	{
+		boost::asio::read(socket_, buffer_, boost::asio::transfer_at_least(size > buffer_.size() ? size - buffer_.size() : 0));
+		boost::asio::buffer_copy(boost::asio::buffer(data, size), buffer_.data());
+		buffer_.consume(size);
+	}
+
+	boost::asio::io_context ioContext_;
+	boost::asio::ip::tcp::socket socket_;
+	boost::asio::streambuf buffer_;
+};
+
+BOOST_AUTO_TEST_CASE(testHandshake)
+{
+	WebSocketClient client;
+	std::string header = client.connect("/Echo");
+
+	BOOST_CHECK(boost::algorithm::starts_with(header, "HTTP/1.1 101 "));
+	BOOST_CHECK(header.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(testEcho)
+{
+	WebSocketClient client;
+	client.connect("/Echo");
+
+	std::string payload;
+	client.sendFrame(1, "Hello");
+	BOOST_CHECK_EQUAL(1, client.readFrame(payload));
+	BOOST_CHECK_EQUAL(std::string("Hello"), payload);
+
+	std::string large(1000, 'x');
+	client.sendFrame(2, large);
+	BOOST_CHECK_EQUAL(2, client.readFrame(payload));
+	BOOST_CHECK_EQUAL(large, payload);
+}
+
+BOOST_AUTO_TEST_CASE(testFragmentedWithPing)
+{
+	WebSocketClient client;
+	client.connect("/Echo");
+
+	std::string payload;
+	client.sendFrame(1, "Hel", false);
+	client.sendFrame(9, "ping");
+	client.sendFrame(0, "lo", false);
+	client.sendFrame(0, ", World");
+
+	BOOST_CHECK_EQUAL(10, client.readFrame(payload));
+	BOOST_CHECK_EQUAL(std::string("ping"), payload);
+	BOOST_CHECK_EQUAL(1, client.readFrame(payload));
+	BOOST_CHECK_EQUAL(std::string("Hello, World"), payload);
+}
+
+BOOST_AUTO_TEST_CASE(testClose)
+{
+	WebSocketClient client;
+	client.connect("/Echo");
+
+	std::string payload;
+	client.sendFrame(1, "bye");
+	BOOST_CHECK_EQUAL(8, client.readFrame(payload));
+	BOOST_CHECK_EQUAL(std::string("\x03\xe9" "bye"), payload);   // 1001 going away
+	client.sendFrame(8, payload.substr(0, 2));
+}
+
+BOOST_AUTO_TEST_CASE(testInvalidUtf8)
+{
+	WebSocketClient client;
+	client.connect("/Echo");
+
+	std::string payload;
+	client.sendFrame(1, "\xc0\xaf");
+	BOOST_CHECK_EQUAL(8, client.readFrame(payload));
+	BOOST_CHECK_EQUAL(std::string("\x03\xef"), payload);    // 1007 invalid payload
+}
+
+#if defined(BOOST_ASIO_HTTP_USE_ZLIB)
+
+// Client side of permessage-deflate with context takeover in both directions.
+class DeflateContext
+{
+public:
+	DeflateContext()
+	{
+		std::memset(&deflate_, 0, sizeof(deflate_));
+		std::memset(&inflate_, 0, sizeof(inflate_));
+		deflateInit2(&deflate_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+		inflateInit2(&inflate_, -15);
+	}
+
+	~DeflateContext()
+	{
+		deflateEnd(&deflate_);
+		inflateEnd(&inflate_);
+	}
+
+	std::string compress(const std::string& data)
+	{
+		std::string out(data.size() + 64, '\0');
+		deflate_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+		deflate_.avail_in = static_cast<uInt>(data.size());
+		deflate_.next_out = reinterpret_cast<Bytef*>(&out[0]);
+		deflate_.avail_out = static_cast<uInt>(out.size());
+		deflate(&deflate_, Z_SYNC_FLUSH);
+		out.resize(out.size() - deflate_.avail_out - 4);    // without the trailing 00 00 ff ff
+		return out;
+	}
+
+	std::string decompress(std::string data)
+	{
+		data.append("\x00\x00\xff\xff", 4);
+		std::string out(64 * 1024, '\0');
+		inflate_.next_in = reinterpret_cast<Bytef*>(&data[0]);
+		inflate_.avail_in = static_cast<uInt>(data.size());
+		inflate_.next_out = reinterpret_cast<Bytef*>(&out[0]);
+		inflate_.avail_out = static_cast<uInt>(out.size());
+		if (inflate(&inflate_, Z_SYNC_FLUSH) != Z_OK) return "<corrupt>";
+		out.resize(out.size() - inflate_.avail_out);
+		return out;
+	}
+
+private:
+	z_stream deflate_, inflate_;
+};
+
+BOOST_AUTO_TEST_CASE(testPermessageDeflate)
+{
+	WebSocketClient client;
+	std::string header = client.connect("/Echo", "Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits\r\n");
+	BOOST_CHECK(header.find("\r\nSec-WebSocket-Extensions: permessage-deflate\r\n") != std::string::npos);
+
+	DeflateContext context;
+	std::string message = "{\"position\": [1.0, 2.0, 3.0], \"velocity\": [0.0, 0.0, 0.0]}";
+	std::string payload, frames[2];
+	bool rsv1 = false;
+
+	// the second message only decodes against the window left by the first, in both directions
+	for (auto& frame : frames) {
+		std::string compressed = context.compress(message);
+		client.sendFrame(1, compressed, true, true);
+
+		BOOST_CHECK_EQUAL(1, client.readFrame(frame, &rsv1));
+		BOOST_CHECK(rsv1);
+		BOOST_CHECK_EQUAL(message, context.decompress(frame));
+	}
+	BOOST_CHECK_LT(frames[1].size(), frames[0].size());
+
+	// uncompressed messages are still accepted
+	client.sendFrame(1, "plain");
+	client.readFrame(payload, &rsv1);
+	BOOST_CHECK_EQUAL(std::string("plain"), context.decompress(payload));
+}
+
+BOOST_AUTO_TEST_CASE(testPermessageDeflateNoContextTakeover)
+{
+	WebSocketClient client;
+	std::string header = client.connect("/Echo", "Sec-WebSocket-Extensions: permessage-deflate; server_no_context_takeover\r\n");
+	BOOST_CHECK(header.find("\r\nSec-WebSocket-Extensions: permessage-deflate; server_no_context_takeover\r\n") != std::string::npos);
+
+	DeflateContext context;
+	std::string message(200, 'a');
+	std::string frames[2];
+	for (auto& frame : frames) {
+		client.sendFrame(2, context.compress(message), true, true);
+		client.readFrame(frame);
+	}
+	// the server starts every message with an empty window
+	BOOST_CHECK(frames[0] == frames[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testPermessageDeflateErrors)
+{
+	std::string payload;
+	{
+		WebSocketClient client;
+		client.connect("/Echo", "Sec-WebSocket-Extensions: permessage-deflate\r\n");
+		client.sendFrame(2, "\xff\xff\xff\xff", true, true);     // reserved block type
+		BOOST_CHECK_EQUAL(8, client.readFrame(payload));
+		BOOST_CHECK_EQUAL(std::string("\x03\xef"), payload);    // 1007 invalid payload
+	}
+	{
+		WebSocketClient client;
+		client.connect("/Echo", "Sec-WebSocket-Extensions: permessage-deflate\r\n");
+		DeflateContext context;
+		client.sendFrame(2, context.compress(std::string(17 * 1024 * 1024, '\0')), true, true);
+		BOOST_CHECK_EQUAL(8, client.readFrame(payload));
+		BOOST_CHECK_EQUAL(std::string("\x03\xf1"), payload);    // 1009 message too big
+	}
+}
+
+#endif
+
+
+BOOST_AUTO_TEST_SUITE_END()